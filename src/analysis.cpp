@@ -0,0 +1,134 @@
+#include <algorithm>
+#include "analysis.h"
+#include "arena.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANALYSIS_USE_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ANALYSIS_USE_NEON
+#endif
+
+namespace Analysis {
+	namespace {
+		const int tileColumns = 4;
+		const int tileRows = 4;
+		// Pixels per vectorized run, keeping the 32-bit sums of squared Laplacians from overflowing
+		const int maxRunLength = 1024;
+
+		struct TileSums {
+			long long sum = 0;
+			long long squares = 0;
+			long long count = 0;
+		};
+
+		void convertToLuma(const unsigned char* rgb, unsigned char* luma, int count) {
+			for (int i = 0; i < count; i++) {
+				const unsigned int r = rgb[i * 3];
+				const unsigned int g = rgb[i * 3 + 1];
+				const unsigned int b = rgb[i * 3 + 2];
+				luma[i] = static_cast<unsigned char>((77 * r + 150 * g + 29 * b + 128) >> 8);
+			}
+		}
+
+		/*
+		Adds the 4-neighbor Laplacian of `row` over columns [start, end) to the sums. Columns must not
+		include the first or last of the row, and `above` and `below` are the neighboring rows.
+		*/
+		void accumulateLaplacian(const unsigned char* above, const unsigned char* row, const unsigned char* below, int start, int end, TileSums& sums) {
+			sums.count += end - start;
+			int x = start;
+#if defined(ANALYSIS_USE_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i ones = _mm_set1_epi16(1);
+			while (x + 8 <= end) {
+				const int runEnd = std::min(end, x + maxRunLength);
+				__m128i runSums = _mm_setzero_si128();
+				__m128i runSquares = _mm_setzero_si128();
+				for (; x + 8 <= runEnd; x += 8) {
+					__m128i center = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x)), zero);
+					__m128i left = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x - 1)), zero);
+					__m128i right = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x + 1)), zero);
+					__m128i up = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(above + x)), zero);
+					__m128i down = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(below + x)), zero);
+					__m128i neighbors = _mm_add_epi16(_mm_add_epi16(left, right), _mm_add_epi16(up, down));
+					__m128i laplacian = _mm_sub_epi16(_mm_slli_epi16(center, 2), neighbors);
+					runSums = _mm_add_epi32(runSums, _mm_madd_epi16(laplacian, ones));
+					runSquares = _mm_add_epi32(runSquares, _mm_madd_epi16(laplacian, laplacian));
+				}
+				alignas(16) int lanes[8];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes), runSums);
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes + 4), runSquares);
+				sums.sum += static_cast<long long>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+				sums.squares += static_cast<long long>(lanes[4]) + lanes[5] + lanes[6] + lanes[7];
+			}
+#elif defined(ANALYSIS_USE_NEON)
+			int64x2_t vectorSums = vdupq_n_s64(0);
+			int64x2_t vectorSquares = vdupq_n_s64(0);
+			for (; x + 8 <= end; x += 8) {
+				int16x8_t center = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + x)));
+				int16x8_t left = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + x - 1)));
+				int16x8_t right = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(row + x + 1)));
+				int16x8_t up = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(above + x)));
+				int16x8_t down = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(below + x)));
+				int16x8_t neighbors = vaddq_s16(vaddq_s16(left, right), vaddq_s16(up, down));
+				int16x8_t laplacian = vsubq_s16(vshlq_n_s16(center, 2), neighbors);
+				vectorSums = vpadalq_s32(vectorSums, vpaddlq_s16(laplacian));
+				vectorSquares = vpadalq_s32(vectorSquares, vmull_s16(vget_low_s16(laplacian), vget_low_s16(laplacian)));
+				vectorSquares = vpadalq_s32(vectorSquares, vmull_s16(vget_high_s16(laplacian), vget_high_s16(laplacian)));
+			}
+			sums.sum += vgetq_lane_s64(vectorSums, 0) + vgetq_lane_s64(vectorSums, 1);
+			sums.squares += vgetq_lane_s64(vectorSquares, 0) + vgetq_lane_s64(vectorSquares, 1);
+#endif
+			for (; x < end; x++) {
+				const int laplacian = 4 * row[x] - row[x - 1] - row[x + 1] - above[x] - below[x];
+				sums.sum += laplacian;
+				sums.squares += laplacian * laplacian;
+			}
+		}
+	}
+
+	float sharpness(const unsigned char* source, glm::ivec2 sourceSize) {
+		// Each tile needs an interior pixel with all four neighbors
+		if (sourceSize.x < tileColumns + 2 || sourceSize.y < tileRows + 2) return 0.0f;
+
+		// Luma is converted a row at a time into a ring of three rows
+		const size_t width = sourceSize.x;
+		unsigned char* luma = static_cast<unsigned char*>(Arena::allocate(width * 3));
+		unsigned char* rows[3] = { luma, luma + width, luma + width * 2 };
+		convertToLuma(source, rows[0], sourceSize.x);
+		convertToLuma(source + width * 3, rows[1], sourceSize.x);
+
+		TileSums tiles[tileRows][tileColumns];
+		int tileRight[tileColumns];
+		for (int column = 0; column < tileColumns; column++) {
+			tileRight[column] = 1 + (column + 1) * (sourceSize.x - 2) / tileColumns;
+		}
+
+		for (int y = 1; y < sourceSize.y - 1; y++) {
+			convertToLuma(source + (y + 1) * width * 3, rows[2], sourceSize.x);
+
+			const int tileRow = std::min((y - 1) * tileRows / (sourceSize.y - 2), tileRows - 1);
+			int left = 1;
+			for (int column = 0; column < tileColumns; column++) {
+				accumulateLaplacian(rows[0], rows[1], rows[2], left, tileRight[column], tiles[tileRow][column]);
+				left = tileRight[column];
+			}
+
+			std::rotate(rows, rows + 1, rows + 3);
+		}
+		Arena::release(luma);
+
+		double maxVariance = 0.0;
+		for (const auto& tileRow : tiles) {
+			for (const TileSums& tile : tileRow) {
+				if (tile.count == 0) continue;
+				const double mean = tile.sum / static_cast<double>(tile.count);
+				const double variance = tile.squares / static_cast<double>(tile.count) - mean * mean;
+				maxVariance = std::max(maxVariance, variance);
+			}
+		}
+		return static_cast<float>(maxVariance);
+	}
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <format>
 #include "application.h"
 #include "cache.h"
@@ -9,8 +10,9 @@ Application::Application(GLFWwindow* window) : window(window) {
     preloadPreviousImageCount = config.cacheBackwardPreload;
 
     cache = new ImageCache(config.cacheCapacity);
+    cache->setResidentPreviewTiers(config.previewTiers);
     monitor = new Monitor();
-    ui = new UI(window, config, groups, cache, groupParameters, monitor);
+    ui = new UI(window, config, groups, groupIndex, groupingIndex, cache, groupParameters, monitor);
 
     directoryLoaded.store(false);
 
@@ -32,6 +34,7 @@ Application::Application(GLFWwindow* window) : window(window) {
         processingState = ProcessingState_None;
         ui->reset();
         cache->clear();
+        groupingIndex = {};
         glfwSetWindowTitle(window, "Cormorant");
         directoryOpen = false;
     };
@@ -46,7 +49,15 @@ Application::Application(GLFWwindow* window) : window(window) {
     };
 
     ui->onRegenerateGroups = [this]() -> void {
-        generateGroups(groups, groupParameters, cache->getImages());
+        // Metadata may have been read since the index was built, so it's built again
+        Group::buildGroupingIndex(groupingIndex, groupParameters, cache->getImages());
+        generateGroups(groups, groupingIndex, groupParameters);
+        Group::buildIndex(groupIndex, groups, cache->getImages());
+    };
+
+    ui->onGroupParametersChanged = [this]() -> void {
+        generateGroups(groups, groupingIndex, groupParameters);
+        Group::buildIndex(groupIndex, groups, cache->getImages());
     };
 
     ui->onSaveImage = [this](int id) -> void {
@@ -66,6 +77,7 @@ Application::Application(GLFWwindow* window) : window(window) {
         }
         group.savedCount = static_cast<int>(group.ids.size());
         group.skippedCount = 0;
+        Group::rebuildGroupIndex(groupIndex, groups, i, cache->getImages());
     };
 
     ui->onSkipGroup = [this](int i) -> void {
@@ -76,6 +88,7 @@ Application::Application(GLFWwindow* window) : window(window) {
         }
         group.skippedCount = static_cast<int>(group.ids.size());
         group.savedCount = 0;
+        Group::rebuildGroupIndex(groupIndex, groups, i, cache->getImages());
     };
 
     ui->onResetGroup = [this](int i) -> void {
@@ -86,12 +99,20 @@ Application::Application(GLFWwindow* window) : window(window) {
         }
         group.skippedCount = 0;
         group.savedCount = 0;
+        Group::rebuildGroupIndex(groupIndex, groups, i, cache->getImages());
+    };
+
+    ui->onSortGroup = [this](int i, Group::GroupSort sort) -> void {
+        Group::sortGroup(groups.at(i), sort, cache->getImages());
+        Group::buildIndex(groupIndex, groups, cache->getImages());
     };
 
     ui->onConfigUpdate = [this](Config::Config& updateConfig) -> void {
         config.update(updateConfig);
         Config::saveConfig(config);
         cache->updateCapacity(config.cacheCapacity);
+        // Takes effect with the previews of the next directory opened
+        cache->setResidentPreviewTiers(config.previewTiers);
         ui->onDirectoryClosed();
     };
 
@@ -104,9 +125,19 @@ Application::~Application() {
 }
 
 void Application::frameUpdate() {
+    // Nothing is drawn while minimized, and background decoding is paused until the window is restored.
+    bool iconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+    cache->setPaused(iconified);
+    if (iconified) {
+        glfwWaitEvents();
+        previousFrameTime = glfwGetTime();
+        activeFramesRemaining = framesAfterEvent;
+        return;
+    }
+
     BlockTimer frameTimer{monitor, Monitor_FrameTime};
 
-    double elapsed = glfwGetTime() - previousFrameTime;
+    double elapsed = std::min(glfwGetTime() - previousFrameTime, maxFrameElapsed);
     previousFrameTime = glfwGetTime();
 
     int width, height;
@@ -120,7 +151,7 @@ void Application::frameUpdate() {
     ui->renderFrame(elapsed);
 
     glfwSwapBuffers(window);
-    glfwPollEvents();
+    processEvents();
 
     switch (processingState) {
     case ProcessingState_LoadingDirectory:
@@ -130,29 +161,51 @@ void Application::frameUpdate() {
             ui->setShowPreviewProgress(true);
             cache->startInitialTextureLoads();
             generateInitialGroup(groups, cache->getImages());
+            Group::buildIndex(groupIndex, groups, cache->getImages());
+            Group::buildGroupingIndex(groupingIndex, groupParameters, cache->getImages());
             ui->setControlPanelState(ControlPanel_ShowGroups);
         }
         break;
     case ProcessingState_LoadingPreviews:
         if (cache->previewLoadingComplete()) {
             processingState = ProcessingState_None;
+            // The metadata used for grouping is read along with the previews
+            Group::buildGroupingIndex(groupingIndex, groupParameters, cache->getImages());
             ui->endLoadingImages();
         }
         break;
     }
 }
 
+void Application::processEvents() {
+    if (activeFramesRemaining > 0 || ui->isAnimating() || cache->hasPendingWork()) {
+        activeFramesRemaining = std::max(activeFramesRemaining - 1, 0);
+        glfwPollEvents();
+        return;
+    }
+
+    // Returning before the timeout means an event arrived, either input or a wake from another thread
+    double waitStart = glfwGetTime();
+    glfwWaitEventsTimeout(idleWaitSeconds);
+    if (glfwGetTime() - waitStart < idleWaitSeconds) {
+        activeFramesRemaining = framesAfterEvent;
+    }
+}
+
 void Application::onKeyPress(int key, int scancode, int action, int mods) {
+    activeFramesRemaining = framesAfterEvent;
     if (action == GLFW_PRESS) {
         ui->inputKey(key);
     }
 }
 
 void Application::onClick(int button, int action, int mods) {
+    activeFramesRemaining = framesAfterEvent;
     ui->inputClick(button, action, mods);
 }
 
 void Application::onMouseMove(double x, double y) {
+    activeFramesRemaining = framesAfterEvent;
     ui->inputMouseMove(x, y);
 }
 
@@ -161,88 +214,81 @@ void Application::onWindowResized(int width, int height) {
 }
 
 void Application::onScroll(int offset) {
+    activeFramesRemaining = framesAfterEvent;
     ui->inputScroll(offset);
 }
 
 void Application::loadImageWithPreload(int id) {
-    int indexInGroup = -1;
-    std::vector<int>& group = groups.at(ui->getCurrentGroupIndex()).ids;
-    for (int i = 0; i < group.size(); i++) {
-        if (group[i] == id) {
-            indexInGroup = i;
-            break;
-        }
-    }
+    Group::ImageLocation location;
+    int currentGroup = ui->getCurrentGroupIndex();
 
-    if (indexInGroup == -1) {
+    if (!Group::findImage(groupIndex, id, location) || location.group != currentGroup) {
         cache->useImageFullTexture(id);
     } else {
-        // Also load a few images ahead and behind when loading the selected image.
-        const auto& images = cache->getImages();
+        // Also load a few unskipped images ahead and behind when loading the selected image.
+        const std::vector<int>& group = groups.at(currentGroup).ids;
         std::vector<int> imageIDs;
         imageIDs.push_back(id);
 
-        int count = 0;
-        for (int i = indexInGroup + 1; i < group.size() && count < preloadNextImageCount; i++) {
-            int preloadID = group.at(i);
-            if (!images.at(preloadID).skipped) {
-                imageIDs.push_back(preloadID);
-                count++;
-            }
+        int position = location.position;
+        for (int count = 0; count < preloadNextImageCount; count++) {
+            position = Group::findNextUnskipped(groupIndex, currentGroup, position);
+            if (position == -1) break;
+            imageIDs.push_back(group.at(position));
         }
 
-        count = 0;
-        for (int i = indexInGroup - 1; i >= 0 && count < preloadPreviousImageCount; i--) {
-            int preloadID = group.at(i);
-            if (!images.at(preloadID).skipped) {
-                imageIDs.push_back(preloadID);
-                count++;
-            }
+        position = location.position;
+        for (int count = 0; count < preloadPreviousImageCount; count++) {
+            position = Group::findPreviousUnskipped(groupIndex, currentGroup, position);
+            if (position == -1) break;
+            imageIDs.push_back(group.at(position));
         }
 
         cache->useImagesFullTextures(imageIDs);
     }
+
+    // The selected image is needed first, ahead of the preloads and any earlier requests
+    cache->prioritizeImage(id);
 }
 
 void Application::toggleSkipImage(int id) {
     Image* image = cache->getImage(id);
 
-    // TODO: have a mapping from image id to group index to avoid this linear search
-    for (auto& group : groups) {
-        if (std::find(group.ids.begin(), group.ids.end(), id) != group.ids.end()) {
-            if (image->skipped) {
-                group.skippedCount--;
-            } else {
-                group.skippedCount++;
-                if (image->saved) {
-                    group.savedCount--;
-                }
+    Group::ImageLocation location;
+    if (Group::findImage(groupIndex, id, location)) {
+        auto& group = groups.at(location.group);
+        if (image->skipped) {
+            group.skippedCount--;
+        } else {
+            group.skippedCount++;
+            if (image->saved) {
+                group.savedCount--;
             }
-            break;
         }
     }
 
     image->skipped = !image->skipped;
     image->saved = false;
+    Group::setSkipped(groupIndex, id, image->skipped);
 }
 
 void Application::toggleSaveImage(int id) {
     Image* image = cache->getImage(id);
 
-    for (auto& group : groups) {
-        if (std::find(group.ids.begin(), group.ids.end(), id) != group.ids.end()) {
-            if (image->saved) {
-                group.savedCount--;
-            } else {
-                group.savedCount++;
-                if (image->skipped) {
-                    group.skippedCount--;
-                }
+    Group::ImageLocation location;
+    if (Group::findImage(groupIndex, id, location)) {
+        auto& group = groups.at(location.group);
+        if (image->saved) {
+            group.savedCount--;
+        } else {
+            group.savedCount++;
+            if (image->skipped) {
+                group.skippedCount--;
             }
-            break;
         }
     }
 
     image->saved = !image->saved;
     image->skipped = false;
+    Group::setSkipped(groupIndex, id, false);
 }
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "arena.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace Arena {
+	namespace {
+		enum BlockKind : unsigned int {
+			// Allocated with malloc, never cached
+			BlockKind_Small = 0,
+			// Allocated from the system as a reusable block
+			BlockKind_Large = 1,
+		};
+
+		/*
+		Stored directly before every pointer handed out by the arena. The header size is a
+		multiple of 64 bytes so returned pointers keep a cache line alignment within blocks.
+		*/
+		struct alignas(64) BlockHeader {
+			// Bytes usable after the header
+			size_t capacity;
+			// Bytes requested by the most recent allocate/reallocate call
+			size_t size;
+			// Bytes obtained from the system, including the header
+			size_t systemBytes;
+			BlockKind kind;
+			bool hugePages;
+		};
+
+		const size_t headerSize = sizeof(BlockHeader);
+		// Requests below this size go straight to malloc. stb_image makes many small allocations
+		// for tables and line buffers that aren't worth caching.
+		const size_t largeBlockThreshold = 4 * 1024;
+		// Blocks are sized in multiples of this to improve reuse across slightly different sizes.
+		const size_t blockGranularity = 64 * 1024;
+		const size_t hugePageSize = 2 * 1024 * 1024;
+		// A cached block is only reused if it wastes less than half of its capacity.
+		const size_t maxReuseWasteFactor = 2;
+		const size_t maxCachedBlocksPerThread = 8;
+		// Older blocks are freed once a thread's cache holds more than this, though the most recently
+		// released block is always kept.
+		const size_t maxCachedBytesPerThread = 256 * 1024 * 1024;
+
+		std::atomic<unsigned long long> allocationCount{0};
+		std::atomic<unsigned long long> reusedAllocationCount{0};
+		std::atomic<unsigned long long> systemAllocationCount{0};
+		std::atomic<unsigned long long> hugePageAllocationCount{0};
+		std::atomic<unsigned long long> reservedByteCount{0};
+
+#if defined(_WIN32)
+		// Large pages require the SeLockMemoryPrivilege, which most users won't have. After the
+		// first failure, don't attempt them again.
+		std::atomic_bool largePagesAvailable{true};
+#endif
+
+		void* systemAllocate(size_t bytes, bool& hugePages) {
+			hugePages = false;
+#if defined(_WIN32)
+			if (bytes >= hugePageSize && largePagesAvailable.load()) {
+				size_t largePageMinimum = GetLargePageMinimum();
+				if (largePageMinimum > 0 && bytes % largePageMinimum == 0) {
+					void* pointer = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+					if (pointer) {
+						hugePages = true;
+						return pointer;
+					}
+				}
+				largePagesAvailable.store(false);
+			}
+			return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+			size_t alignment = bytes >= hugePageSize ? hugePageSize : 64;
+			void* pointer = nullptr;
+			if (posix_memalign(&pointer, alignment, bytes) != 0) {
+				return nullptr;
+			}
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+			if (bytes >= hugePageSize) {
+				hugePages = madvise(pointer, bytes, MADV_HUGEPAGE) == 0;
+			}
+#endif
+			return pointer;
+#endif
+		}
+
+		void systemFree(void* pointer) {
+#if defined(_WIN32)
+			VirtualFree(pointer, 0, MEM_RELEASE);
+#else
+			free(pointer);
+#endif
+		}
+
+		BlockHeader* headerOf(void* pointer) {
+			return reinterpret_cast<BlockHeader*>(static_cast<unsigned char*>(pointer) - headerSize);
+		}
+
+		void* dataOf(BlockHeader* header) {
+			return reinterpret_cast<unsigned char*>(header) + headerSize;
+		}
+
+		void freeBlock(BlockHeader* header) {
+			reservedByteCount -= header->systemBytes;
+			systemFree(header);
+		}
+
+		/*
+		Released large blocks for a single thread, ordered from least to most recently released.
+		*/
+		struct BlockCache {
+			std::vector<BlockHeader*> blocks;
+			size_t cachedBytes = 0;
+
+			~BlockCache() {
+				for (BlockHeader* header : blocks) {
+					freeBlock(header);
+				}
+			}
+
+			// Frees every block except the largest.
+			void trim() {
+				auto largest = std::max_element(blocks.begin(), blocks.end(), [](const BlockHeader* a, const BlockHeader* b) {
+					return a->systemBytes < b->systemBytes;
+				});
+				if (largest == blocks.end()) return;
+
+				BlockHeader* kept = *largest;
+				for (BlockHeader* header : blocks) {
+					if (header != kept) freeBlock(header);
+				}
+				blocks.assign(1, kept);
+				cachedBytes = kept->systemBytes;
+			}
+
+			// Returns the smallest cached block that fits the size without wasting too much space.
+			BlockHeader* take(size_t size) {
+				auto best = blocks.end();
+				for (auto i = blocks.begin(); i != blocks.end(); i++) {
+					size_t capacity = (*i)->capacity;
+					if (capacity >= size && capacity <= size * maxReuseWasteFactor + blockGranularity) {
+						if (best == blocks.end() || capacity < (*best)->capacity) {
+							best = i;
+						}
+					}
+				}
+
+				if (best == blocks.end()) {
+					return nullptr;
+				}
+
+				BlockHeader* header = *best;
+				blocks.erase(best);
+				cachedBytes -= header->systemBytes;
+				return header;
+			}
+
+			void put(BlockHeader* header) {
+				while (!blocks.empty() && (blocks.size() == maxCachedBlocksPerThread || cachedBytes + header->systemBytes > maxCachedBytesPerThread)) {
+					cachedBytes -= blocks.front()->systemBytes;
+					freeBlock(blocks.front());
+					blocks.erase(blocks.begin());
+				}
+				blocks.push_back(header);
+				cachedBytes += header->systemBytes;
+			}
+		};
+
+		thread_local BlockCache blockCache;
+
+		size_t roundUp(size_t value, size_t multiple) {
+			return (value + multiple - 1) / multiple * multiple;
+		}
+	}
+
+	void* allocate(size_t size) {
+		allocationCount++;
+
+		if (size < largeBlockThreshold) {
+			BlockHeader* header = static_cast<BlockHeader*>(malloc(headerSize + size));
+			if (!header) return nullptr;
+			header->capacity = size;
+			header->size = size;
+			header->systemBytes = 0;
+			header->kind = BlockKind_Small;
+			header->hugePages = false;
+			return dataOf(header);
+		}
+
+		BlockHeader* header = blockCache.take(size);
+		if (header) {
+			reusedAllocationCount++;
+			header->size = size;
+			return dataOf(header);
+		}
+
+		size_t systemBytes = roundUp(headerSize + size, blockGranularity);
+		if (systemBytes >= hugePageSize) {
+			systemBytes = roundUp(systemBytes, hugePageSize);
+		}
+
+		bool hugePages = false;
+		void* pointer = systemAllocate(systemBytes, hugePages);
+		if (!pointer) return nullptr;
+
+		systemAllocationCount++;
+		if (hugePages) hugePageAllocationCount++;
+		reservedByteCount += systemBytes;
+
+		header = static_cast<BlockHeader*>(pointer);
+		header->capacity = systemBytes - headerSize;
+		header->size = size;
+		header->systemBytes = systemBytes;
+		header->kind = BlockKind_Large;
+		header->hugePages = hugePages;
+		return dataOf(header);
+	}
+
+	void* reallocate(void* pointer, size_t size) {
+		if (pointer == nullptr) {
+			return allocate(size);
+		}
+
+		BlockHeader* header = headerOf(pointer);
+		if (size <= header->capacity && (header->kind == BlockKind_Large || size < largeBlockThreshold)) {
+			header->size = size;
+			return pointer;
+		}
+
+		void* newPointer = allocate(size);
+		if (!newPointer) return nullptr;
+		memcpy(newPointer, pointer, std::min(size, header->size));
+		release(pointer);
+		return newPointer;
+	}
+
+	void release(void* pointer) {
+		if (pointer == nullptr) return;
+
+		BlockHeader* header = headerOf(pointer);
+		if (header->kind == BlockKind_Small) {
+			free(header);
+		} else {
+			blockCache.put(header);
+		}
+	}
+
+	void trim() {
+		blockCache.trim();
+	}
+
+	void getStats(ArenaStats& stats) {
+		stats.allocations = allocationCount.load();
+		stats.reusedAllocations = reusedAllocationCount.load();
+		stats.systemAllocations = systemAllocationCount.load();
+		stats.hugePageAllocations = hugePageAllocationCount.load();
+		stats.reservedBytes = reservedByteCount.load();
+	}
+}
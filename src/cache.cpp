@@ -1,33 +1,59 @@
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#define STB_IMAGE_IMPLEMENTATION
+#include "analysis.h"
+#include "arena.h"
 #include <stb_image.h>
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include <stb_image_resize2.h>
 #include <thread>
 #include <TinyEXIF.h>
 #include "cache.h"
 #include "glCommon.h"
+#include "jpeg.h"
+#include "resize.h"
 
 namespace fs = std::filesystem;
 
-ImageCache::ImageCache(int capacity) : cacheCapacity(capacity) {
-	const int channels = 3;
-	previewTextureBackground = new unsigned char[previewTextureSize.x * previewTextureSize.y * channels];
-	for (int x = 0; x < previewTextureSize.x; x++) {
-		for (int y = 0; y < previewTextureSize.y; y++) {
-			int i = y * previewTextureSize.x * channels + x * channels;
-			previewTextureBackground[i + 0] = previewBackgroundColor.r;
-			previewTextureBackground[i + 1] = previewBackgroundColor.g;
-			previewTextureBackground[i + 2] = previewBackgroundColor.b;
-		}
+/*
+Expands packed RGB pixels into BGRA with an opaque alpha, the byte order of GL_BGRA with
+GL_UNSIGNED_INT_8_8_8_8_REV. Writes are sequential so the destination may be a mapped PBO.
+*/
+static void copyRGBToBGRA(const unsigned char* source, unsigned char* destination, size_t pixels) {
+	for (size_t i = 0; i < pixels; i++) {
+		destination[0] = source[2];
+		destination[1] = source[1];
+		destination[2] = source[0];
+		destination[3] = 255;
+		source += 3;
+		destination += 4;
+	}
+}
+
+// Returns the smallest mip level of a texture that is at least `minimumSize` in both dimensions, or level 0.
+static int getCoveringMipLevel(glm::ivec2 size, glm::ivec2 minimumSize) {
+	int level = 0;
+	while (level + 1 < TexturePool::getLevelCount(size)) {
+		const glm::ivec2 nextSize = TexturePool::getLevelSize(size, level + 1);
+		if (nextSize.x < minimumSize.x || nextSize.y < minimumSize.y) break;
+		level++;
 	}
+	return level;
+}
+
+// Size with a long edge of `longEdge` and the aspect ratio of `size`.
+static glm::ivec2 getLongEdgeSize(glm::ivec2 size, int longEdge) {
+	if (size.x >= size.y) {
+		return glm::ivec2(longEdge, std::max(static_cast<int>(static_cast<long long>(size.y) * longEdge / std::max(size.x, 1)), 1));
+	}
+	return glm::ivec2(std::max(static_cast<int>(static_cast<long long>(size.x) * longEdge / size.y), 1), longEdge);
+}
 
+ImageCache::ImageCache(int capacity) : cacheCapacity(capacity), texturePool(capacity) {
 	unsigned int hardwareThreads = std::thread::hardware_concurrency();
 	if (hardwareThreads > 0) {
 		imageLoadThreads = hardwareThreads;
 	}
+	parallelDecodeThreads = std::min(imageLoadThreads, maxParallelDecodeThreads);
 
 	// Create the PBOs usable for texture uploads
 	// TODO: is this an appropriate number of PBOs given the number of threads?
@@ -41,27 +67,62 @@ ImageCache::ImageCache(int capacity) : cacheCapacity(capacity) {
 		availablePBOQueue.push_back(entry);
 	}
 
+	// Create the batches shared by preview texture uploads
+	for (int i = 0; i < previewBatchCount; i++) {
+		PreviewBatch* batch = new PreviewBatch();
+		glGenBuffers(1, &batch->pbo);
+		batch->mapping = nullptr;
+		batch->state = PreviewBatch::State_Available;
+		batch->directoryID = 0;
+		batch->tiers = 0;
+		batch->slotBytes = 0;
+		batch->slotCapacity = 0;
+		batch->slotCount = 0;
+		batch->imageIDs.resize(previewBatchCapacity);
+		batch->slotLoaded.resize(previewBatchCapacity);
+		batch->remainingSlots.store(0);
+		batch->fence = nullptr;
+		previewBatches.push_back(batch);
+	}
+
 	runImageLoadThreads.store(true);
+	imageLoadingPaused.store(false);
 	startImageLoadingThreads();
 }
 
 ImageCache::~ImageCache() {
 	runImageLoadThreads.store(false);
 	imageQueueConditionVariable.notify_all();
-	delete[] previewTextureBackground;
 	clear();
+
+	for (unsigned int pbo : availableReadbackPBOs) {
+		glDeleteBuffers(1, &pbo);
+	}
+
+	for (PreviewBatch* batch : previewBatches) {
+		glDeleteBuffers(1, &batch->pbo);
+		delete batch;
+	}
+	previewBatches.clear();
 }
 
 void ImageCache::clear() {
-	// Clear the image queue, returning PBOs back to the available pool.
+	// Clear the image queue, returning PBOs back to the available pool. Preview slots of removed entries
+	// are released so that their batches still complete.
 	{
 		std::lock_guard<std::mutex> guard(imageQueueMutex);
 		for (const auto& entry : imageQueue) {
-			PBOQueueEntry pboEntry{
-				.pbo = entry.pbo,
-				.mappedBuffer = nullptr
-			};
-			availablePBOQueue.push_back(pboEntry);
+			if (entry.pbo != 0) {
+				PBOQueueEntry pboEntry{
+					.pbo = entry.pbo,
+					.mappedBuffer = nullptr
+				};
+				availablePBOQueue.push_back(pboEntry);
+			}
+			if (entry.previewBatch) {
+				entry.previewBatch->slotLoaded[entry.previewSlot] = false;
+				entry.previewBatch->remainingSlots--;
+			}
 		}
 		imageQueue.clear();
 	}
@@ -79,17 +140,34 @@ void ImageCache::clear() {
 		textureQueue.clear();
 	}
 
-	for (const auto& entry : images) {
-		glDeleteTextures(1, &entry.second.previewTextureId);
-		glDeleteTextures(1, &entry.second.fullTextureId);
+	for (auto& entry : images) {
+		for (const Preview& preview : entry.second.previews) {
+			if (preview.loaded) {
+				glDeleteTextures(1, &preview.textureId);
+			}
+		}
+		if (entry.second.imageLoaded) {
+			releaseFullTextures(entry.second);
+		}
 	}
 	images.clear();
+	// Buffers for previews created from mip levels are released on this thread
+	Arena::trim();
 
 	pendingImageQueue.clear();
 	pendingImageQueueIds.clear();
+	pendingPreviewIds.clear();
+	previewsInFlight.clear();
 	pboToFence.clear();
 	textureIds.clear();
 	previewsLoaded.clear();
+	Similarity::clear(similarityIndex);
+	mipmapQueue.clear();
+	for (const MipmapReadback& readback : mipmapReadbacks) {
+		glDeleteSync(readback.fence);
+		availableReadbackPBOs.push_back(readback.pbo);
+	}
+	mipmapReadbacks.clear();
 
 	// Increment current directory id so that any previous queue entries
 	// will be ignore by the current cache state.
@@ -113,16 +191,49 @@ void ImageCache::frameUpdate() {
 	processPendingPBOQueue();
 	processPendingImageQueue();
 	processTextureQueue();
+	processMipmapQueue();
+	processMipmapReadbacks();
+	processPreviewBatches();
 	assert(textureIds.size() <= cacheCapacity && "Number of in-use textures has exceeded cache capacity.");
 }
 
+bool ImageCache::hasPendingWork() {
+	if (!pendingImageQueue.empty() || !pboToFence.empty() || !mipmapQueue.empty() || !mipmapReadbacks.empty()) {
+		return true;
+	}
+
+	// Batches still being decoded are completed by the image loading threads, which wake the main thread
+	bool uploadingBatch = std::any_of(previewBatches.begin(), previewBatches.end(), [](const PreviewBatch* batch) {
+		return batch->state == PreviewBatch::State_Uploading;
+	});
+	if (uploadingBatch) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> guard(textureQueueMutex);
+	return !textureQueue.empty();
+}
+
+void ImageCache::setPaused(bool paused) {
+	if (imageLoadingPaused.exchange(paused) && !paused) {
+		// Resume threads that stopped with entries left in the queue
+		imageQueueConditionVariable.notify_all();
+	}
+}
+
 void ImageCache::updateCapacity(int capacity) {
 	cacheCapacity = capacity;
+	texturePool.setMaxFreeTextures(capacity);
+}
+
+void ImageCache::setResidentPreviewTiers(int tiers) {
+	residentPreviewTiers = (tiers | (1 << PreviewTier_Small)) & ((1 << PreviewTier_Count) - 1);
 }
 
 void ImageCache::initCacheFromDirectory(std::string path, std::atomic_bool& directoryLoaded) {
 	currentDirectoryID++;
 	previewsLoaded.clear();
+	Similarity::clear(similarityIndex);
 	std::thread thread(&ImageCache::threadInitCacheFromDirectory, this, path, std::ref(directoryLoaded));
 	thread.detach();
 }
@@ -142,14 +253,34 @@ bool ImageCache::previewLoadingComplete() const {
 	return previewsLoaded.size() == images.size();
 }
 
+glm::ivec2 ImageCache::getPreviewTextureSize(PreviewTier tier) const {
+	return previewTextureSizes[tier];
+}
+
+int ImageCache::getResidentPreviewTiers() const {
+	return residentPreviewTiers;
+}
+
 float ImageCache::getPreviewLoadProgress() const {
 	return previewsLoaded.size() / (float)images.size();
 }
 
+void ImageCache::findSimilarImages(int id, int maxDistance, std::vector<Similarity::Match>& matches) const {
+	matches.clear();
+	const Image& image = images.at(id);
+	if (!image.hasDifferenceHash) return;
+
+	Similarity::findWithin(similarityIndex, image.differenceHash, maxDistance, matches);
+	std::erase_if(matches, [id](const Similarity::Match& match) { return match.id == id; });
+}
+
 void ImageCache::getUIData(ImageCacheUIData& data) {
 	// Textures
 	data.cacheCapacity = cacheCapacity;
-	data.previewTextureSize = previewTextureSize;
+	for (int tier = 0; tier < PreviewTier_Count; tier++) {
+		data.previewTextureSizes[tier] = previewTextureSizes[tier];
+	}
+	data.residentPreviewTiers = residentPreviewTiers;
 	data.previewCount = static_cast<int>(previewsLoaded.size());
 	data.fullResolutionCount = static_cast<int>(textureIds.size());
 	data.estimatedPreviewBytes = previewTexturesTotalBytes;
@@ -162,6 +293,14 @@ void ImageCache::getUIData(ImageCacheUIData& data) {
 	data.pendingImageQueueSize = static_cast<int>(pendingImageQueue.size());
 	data.textureQueueSize = static_cast<int>(textureQueue.size());
 	data.pendingPBOSize = static_cast<int>(pboToFence.size());
+	data.pooledTextureCount = texturePool.getTotalTextureCount();
+	data.freePooledTextureCount = texturePool.getFreeTextureCount();
+	data.previewBatchesInFlight = static_cast<int>(std::count_if(previewBatches.begin(), previewBatches.end(), [](const PreviewBatch* batch) {
+		return batch->state != PreviewBatch::State_Available;
+	}));
+
+	// Decode buffers
+	Arena::getStats(data.decodeArenaStats);
 }
 
 void ImageCache::startInitialTextureLoads() {
@@ -172,9 +311,13 @@ void ImageCache::startInitialTextureLoads() {
 			.directoryID = currentDirectoryID,
 			.pbo = 0,
 			.pboMapping = nullptr,
-			.isPreview = true
+			.isPreview = true,
+			.previewBatch = nullptr,
+			.previewSlot = 0,
+			.highPriority = false
 		};
 		pendingImageQueue.push_back(entry);
+		pendingPreviewIds.insert(entry.imageID);
 	}
 
 	// Add enough images for full texture processing to fill cache. The first
@@ -198,7 +341,9 @@ void ImageCache::threadInitCacheFromDirectory(std::string path, std::atomic_bool
 			image.path = entryPathString;
 			image.filename = entryPath.filename().string();
 			image.filesize = static_cast<unsigned int>(fs::file_size(entryPath));
-			image.previewSize = previewTextureSize;
+			for (int tier = 0; tier < PreviewTier_Count; tier++) {
+				image.previews[tier].size = previewTextureSizes[tier];
+			}
 
 			if (image.filename.size() <= shortFilenameLength) {
 				image.shortFilename = image.filename;
@@ -206,82 +351,100 @@ void ImageCache::threadInitCacheFromDirectory(std::string path, std::atomic_bool
 				image.shortFilename = "..." + image.filename.substr(image.filename.size() - shortFilenameLength + 3);
 			}
 
-			int width, height, components;
-			if (stbi_info(image.path.c_str(), &width, &height, &components)) {
-				image.size = glm::ivec2(width, height);
+			Jpeg::JpegInfo info;
+			if (Jpeg::readInfo(image.path, info)) {
+				image.size = info.size;
+				image.planar = info.planar;
+				image.chromaSubsampling = info.chromaSubsampling;
+				setPreviewContentRect(image);
 			} else {
 				// TODO: mark this image with some error flag, cannot be rendered later
 				image.size = glm::ivec2(0, 0);
-				std::cout << "Failed to get info from stbi_info for file " << image.path << std::endl;
+				for (Preview& preview : image.previews) {
+					preview.contentOffset = glm::ivec2(0, 0);
+					preview.contentSize = preview.size;
+				}
+				std::cout << "Failed to read JPEG header for file " << image.path << std::endl;
 			}
 
 			images.emplace(image.id, image);
 		}
 	}
 	directoryLoaded.store(true);
+	glfwPostEmptyEvent();
 }
 
 void ImageCache::runImageLoadThread(int threadID) {
+	bool arenaTrimmed = false;
 	while (runImageLoadThreads.load()) {
-		// Wait for condition variable signal, signaled when main threads adds entries to queue
+		// Wait for condition variable signal, signaled when main threads adds entries to queue. Decode
+		// buffers are kept between images, and only returned once nothing has been queued for a while.
 		std::unique_lock<std::mutex> lock(imageQueueMutex);
-		imageQueueConditionVariable.wait(lock);
+		bool timedOut = imageQueueConditionVariable.wait_for(lock, arenaTrimDelay) == std::cv_status::timeout;
 		lock.unlock();
+		if (timedOut && !arenaTrimmed) {
+			Arena::trim();
+			arenaTrimmed = true;
+		}
 
 		while (true) {
 			ImageQueueEntry imageEntry;
 			{
 				std::lock_guard<std::mutex> imageQueueGuard(imageQueueMutex);
-				if (imageQueue.size() == 0) {
-					// No more entries in image queue, break and go back to waiting on condition.
+				if (imageQueue.size() == 0 || imageLoadingPaused.load()) {
+					// No more entries in image queue, or loading is paused. Break and go back to waiting on condition.
 					break;
 				} else {
 					imageEntry = imageQueue.front();
 					imageQueue.pop_front();
 				}
 			}
+			arenaTrimmed = false;
+
+			// Previews are resized directly into their slot of the batch PBO mapped memory. Full resolution
+			// entries may also carry a preview slot, in which case both are produced from this one decode.
+			unsigned char* previewData = nullptr;
+			int previewTiers = 0;
+			if (imageEntry.previewBatch) {
+				previewData = imageEntry.previewBatch->mapping + static_cast<size_t>(imageEntry.previewSlot) * imageEntry.previewBatch->slotBytes;
+				previewTiers = imageEntry.previewBatch->tiers;
+			}
+			unsigned char* textureData = imageEntry.isPreview ? nullptr : static_cast<unsigned char*>(imageEntry.pboMapping);
 
-			const Image* image = &images.at(imageEntry.imageID);
-			unsigned char* imageData;
-			if (loadImageFromFile(imageEntry.imageID, imageEntry.isPreview, imageData)) {
-				// Copy the image data from memory into the PBO mapped memory location
-				unsigned int imageDataSize = imageEntry.isPreview ?
-					image->previewSize.x * image->previewSize.y * 3 :
-					image->size.x * image->size.y * 3;
-				// TODO: for full resolution images, load directly into the PBO memory to avoid this second copy
-				memcpy(imageEntry.pboMapping, imageData, imageDataSize);
-				if (imageEntry.isPreview) {
-					delete[] imageData;
-				} else {
-					stbi_image_free(imageData);
-				}
-
-				// Push a texture queue entry back to the main thread for uploading
-				TextureQueueEntry textureQueueEntry{
-					.imageID = imageEntry.imageID,
-					.directoryID = imageEntry.directoryID,
-					.pbo = imageEntry.pbo,
-					.isPreview = imageEntry.isPreview
-				};
-				{
+			int decodeThreads = imageEntry.highPriority ? parallelDecodeThreads : 1;
+			bool loaded = loadImageFromFile(imageEntry.imageID, previewData, previewTiers, textureData, decodeThreads);
+			if (loaded) {
+				// Push texture queue entry back to the main thread for uploading
+				if (!imageEntry.isPreview) {
 					std::lock_guard<std::mutex> guard(textureQueueMutex);
+					TextureQueueEntry textureQueueEntry{
+						.imageID = imageEntry.imageID,
+						.directoryID = imageEntry.directoryID,
+						.pbo = imageEntry.pbo
+					};
 					textureQueue.push_back(textureQueueEntry);
+					glfwPostEmptyEvent();
 				}
 			} else {
 				// TODO: is this thread safe?
 				images.at(imageEntry.imageID).imageLoaded = false;
-				images.at(imageEntry.imageID).previewLoaded = false;
+			}
+
+			// The slot is completed even if loading failed, so that the rest of the batch can be uploaded.
+			if (imageEntry.previewBatch) {
+				imageEntry.previewBatch->slotLoaded[imageEntry.previewSlot] = loaded;
+				if (imageEntry.previewBatch->remainingSlots.fetch_sub(1, std::memory_order_release) == 1) {
+					// Last slot of the batch, which can now be uploaded
+					glfwPostEmptyEvent();
+				}
 			}
 		}
 	}
 }
 
-bool ImageCache::loadImageFromFile(int id, bool loadPreview, unsigned char*& imageData) {
+bool ImageCache::loadImageFromFile(int id, unsigned char* previewData, int previewTiers, unsigned char* textureData, int decodeThreads) {
 	Image* image = &images.at(id);
-	stbi_set_flip_vertically_on_load(true);
-	int width = 0, height = 0, channels = 0;
-	imageData = stbi_load(image->path.c_str(), &width, &height, &channels, 3);
-	
+
 	if (!image->fileInfoLoaded) {
 		std::ifstream stream(image->path, std::ios::binary);
 		if (!stream) {
@@ -295,8 +458,14 @@ bool ImageCache::loadImageFromFile(int id, bool loadPreview, unsigned char*& ima
 				image->metadata.shutterSpeed = exif.ExposureTime;
 				image->metadata.iso = exif.ISOSpeedRatings;
 				image->metadata.focalLength = exif.FocalLength;
+				if (!exif.LensInfo.Model.empty()) {
+					image->metadata.lensModel = exif.LensInfo.Model;
+				}
 				image->metadata.bitsPerSample = exif.BitsPerSample;
 				image->metadata.resolution = glm::vec2(exif.XResolution, exif.YResolution);
+				if (exif.Orientation >= 1 && exif.Orientation <= 8) {
+					image->orientation = exif.Orientation;
+				}
 
 				// Preference order for timestamps: original > digitized > last modified
 				if (!exif.DateTimeOriginal.empty()) {
@@ -312,6 +481,47 @@ bool ImageCache::loadImageFromFile(int id, bool loadPreview, unsigned char*& ima
 	}
 	image->fileInfoLoaded = true;
 
+	if (image->planar) {
+		Jpeg::PlanarImage planarImage;
+		if (!Jpeg::decodePlanar(image->path, planarImage, decodeThreads)) {
+			std::cout << "Failed to load image " << image->path << std::endl;
+			return false;
+		}
+
+		if (planarImage.size != image->size || planarImage.chromaSubsampling != image->chromaSubsampling) {
+			std::cout << "Decoded planes don't match the header read for image at " << image->path << std::endl;
+			Jpeg::freePlanarImage(planarImage);
+			return false;
+		}
+
+		if (textureData != nullptr) {
+			// Pack the rows of each plane tightly, dropping the padding the decoder adds to complete blocks
+			unsigned char* destination = textureData;
+			for (const Jpeg::Plane& plane : planarImage.planes) {
+				for (int row = 0; row < plane.size.y; row++) {
+					memcpy(destination, plane.data + static_cast<size_t>(row) * plane.stride, plane.size.x);
+					destination += plane.size.x;
+				}
+			}
+		}
+
+		if (previewData != nullptr) {
+			// The preview is reduced from an RGB image at the chroma resolution, so only a fraction of the
+			// samples need color conversion.
+			const glm::ivec2 chromaSize = planarImage.planes[1].size;
+			unsigned char* rgbData = static_cast<unsigned char*>(Arena::allocate(static_cast<size_t>(chromaSize.x) * chromaSize.y * 3));
+			Jpeg::convertToRGBAtChromaResolution(planarImage, rgbData);
+			writePreviews(*image, rgbData, chromaSize, previewData, previewTiers);
+			Arena::release(rgbData);
+		}
+
+		Jpeg::freePlanarImage(planarImage);
+		return true;
+	}
+
+	int width = 0, height = 0, channels = 0;
+	unsigned char* imageData = stbi_load(image->path.c_str(), &width, &height, &channels, 3);
+
 	if (imageData == nullptr) {
 		std::cout << "Failed to load image " << image->path << std::endl;
 		return false;
@@ -319,95 +529,227 @@ bool ImageCache::loadImageFromFile(int id, bool loadPreview, unsigned char*& ima
 
 	if (channels != 3) {
 		std::cout << "Unexpected channel count (" << channels << ") for image at " << image->path << std::endl;
+		stbi_image_free(imageData);
+		return false;
+	}
+
+	if (glm::ivec2(width, height) != image->size) {
+		std::cout << "Decoded size doesn't match the header read for image at " << image->path << std::endl;
+		stbi_image_free(imageData);
 		return false;
 	}
 
-	if (loadPreview) {
-		// Determine the preview image size that matches the original image aspect ratio, but maximally fits
-		// within the preview image size, which may have a different aspect ratio.
-		const float aspectRatio = width / (float)height;
-		const float previewAspectRatio = previewTextureSize.x / (float)previewTextureSize.y;
-		glm::ivec2 resizeSize = previewTextureSize;
+	if (textureData != nullptr) {
+		copyRGBToBGRA(imageData, textureData, static_cast<size_t>(width) * height);
+	}
+
+	if (previewData != nullptr) {
+		writePreviews(*image, imageData, glm::ivec2(width, height), previewData, previewTiers);
+	}
+
+	stbi_image_free(imageData);
+	return true;
+}
+
+void ImageCache::writePreviews(Image& image, const unsigned char* source, glm::ivec2 sourceSize, unsigned char* previewData, int tiers) {
+	// Each tier is reduced from the content of the tier above it, so only the first reduction reads the
+	// decoded image. `previewData` may be write combined memory, so the larger tiers are resized into a
+	// cached buffer that the next tier reads, then copied into their letterboxed texture.
+	const unsigned char* cascadeSource = source;
+	glm::ivec2 cascadeSize = sourceSize;
+	unsigned char* cascadeBuffer = nullptr;
+
+	// The first reduction hands over its intermediate image, whose size depends on the tiers and on how
+	// the image was decoded. It's resized again to a fixed size, so that the sharpness of every image is
+	// measured at the same scale and can be compared.
+	const Resize::AnalyzeFunction analyze = [this, &image](const unsigned char* pixels, glm::ivec2 size) {
+		const glm::ivec2 analysisSize = getLongEdgeSize(size, analysisLongEdge);
+		unsigned char* analysisData = static_cast<unsigned char*>(Arena::allocate(static_cast<size_t>(analysisSize.x) * analysisSize.y * 3));
+		Resize::resizeLetterboxRGB(pixels, size, analysisData, analysisSize, glm::ivec2(0, 0), analysisSize, previewBackgroundColor);
+		image.differenceHash = Resize::differenceHash(analysisData, analysisSize);
+		image.sharpness = Analysis::sharpness(analysisData, analysisSize);
+		Arena::release(analysisData);
+	};
+
+	for (int tier = PreviewTier_Count - 1; tier > PreviewTier_Small; tier--) {
+		if ((tiers & (1 << tier)) == 0) continue;
+
+		const Preview& preview = image.previews[tier];
+		unsigned char* content = static_cast<unsigned char*>(Arena::allocate(static_cast<size_t>(preview.contentSize.x) * preview.contentSize.y * 3));
+		Resize::resizeLetterboxRGB(cascadeSource, cascadeSize, content, preview.contentSize, glm::ivec2(0, 0), preview.contentSize, previewBackgroundColor,
+			cascadeSource == source ? analyze : nullptr);
+		Resize::letterboxRGB(content, preview.contentSize, previewData + getPreviewTierOffset(tiers, static_cast<PreviewTier>(tier)), preview.size, preview.contentOffset, previewBackgroundColor);
+
+		if (cascadeBuffer) {
+			Arena::release(cascadeBuffer);
+		}
+		cascadeBuffer = content;
+		cascadeSource = content;
+		cascadeSize = preview.contentSize;
+	}
+
+	// Resize into the center of the small preview texture, with bars on the top/bottom or sides filled
+	// with the background color when the aspect ratios differ.
+	const Preview& small = image.previews[PreviewTier_Small];
+	Resize::resizeLetterboxRGB(cascadeSource, cascadeSize, previewData, small.size, small.contentOffset, small.contentSize, previewBackgroundColor,
+		cascadeSource == source ? analyze : nullptr);
+	image.hasDifferenceHash = true;
+	image.hasSharpness = true;
+
+	if (cascadeBuffer) {
+		Arena::release(cascadeBuffer);
+	}
+}
+
+void ImageCache::setPreviewContentRect(Image& image) const {
+	// Determine the preview image size that matches the original image aspect ratio, but maximally fits
+	// within the preview image size, which may have a different aspect ratio.
+	const float aspectRatio = image.size.x / (float)image.size.y;
+	for (Preview& preview : image.previews) {
+		const float previewAspectRatio = preview.size.x / (float)preview.size.y;
+		glm::ivec2 resizeSize = preview.size;
 		if (aspectRatio > previewAspectRatio) {
-			resizeSize.y = static_cast<int>(floor(resizeSize.y * (previewAspectRatio / aspectRatio)));
+			resizeSize.y = std::max(static_cast<int>(floor(resizeSize.y * (previewAspectRatio / aspectRatio))), 1);
 		} else if (aspectRatio < previewAspectRatio) {
-			resizeSize.x = static_cast<int>(floor(resizeSize.x * (aspectRatio / previewAspectRatio)));
-		}
-
-		unsigned char* previewData;
-
-		// Resize original image into preview image size.
-		const int resizedImageBytes = resizeSize.x * resizeSize.y * channels;
-		unsigned char* resizedImageData = new unsigned char[resizedImageBytes];
-		stbir_resize_uint8_srgb(imageData, width, height, 0, resizedImageData, resizeSize.x, resizeSize.y, 0, STBIR_RGB);
-
-		// Place resized image into a larger image that covered the full preview texture size.
-		const int previewImageBytes = previewTextureSize.x * previewTextureSize.y * channels;
-		if (aspectRatio == previewAspectRatio) {
-			// Aspect ratios were equal, so the resized image covers the entire preview texture.
-			previewData = resizedImageData;
-		} else if (aspectRatio > previewAspectRatio) {
-			// Image has a larger w/h ratio, so bars on top/bottom are required.
-			previewData = new unsigned char[previewImageBytes];
-			memcpy(previewData, previewTextureBackground, previewImageBytes);
-
-			int barHeight = (previewTextureSize.y - resizeSize.y) / 2;
-			int middleOffset = barHeight * previewTextureSize.x * channels;
-			memcpy(previewData + middleOffset, resizedImageData, resizedImageBytes);
-			delete[] resizedImageData;
-		} else {
-			// Image has a smaller w/h ratio, so bars on sides are required.
-			previewData = new unsigned char[previewImageBytes];
-			memcpy(previewData, previewTextureBackground, previewImageBytes);
+			resizeSize.x = std::max(static_cast<int>(floor(resizeSize.x * (aspectRatio / previewAspectRatio))), 1);
+		}
 
-			int barWidth = (previewTextureSize.x - resizeSize.x) / 2;
-			for (int y = 0; y < previewTextureSize.y; y++) {
-				memcpy(previewData + (y * previewTextureSize.x * channels) + (barWidth * channels), resizedImageData + (y * resizeSize.x * channels), resizeSize.x * channels);
-			}
-			delete[] resizedImageData;
+		preview.contentOffset = (preview.size - resizeSize) / 2;
+		preview.contentSize = resizeSize;
+	}
+}
+
+unsigned int ImageCache::getPreviewSlotBytes(int tiers) const {
+	unsigned int bytes = 0;
+	for (int tier = 0; tier < PreviewTier_Count; tier++) {
+		if (tiers & (1 << tier)) {
+			bytes += previewTextureSizes[tier].x * previewTextureSizes[tier].y * 3;
 		}
+	}
+	return bytes;
+}
 
-		stbi_image_free(imageData);
-		imageData = previewData;
+unsigned int ImageCache::getPreviewTierOffset(int tiers, PreviewTier tier) const {
+	return getPreviewSlotBytes(tiers & ((1 << tier) - 1));
+}
+
+unsigned int ImageCache::getFullTextureBytes(const Image& image) const {
+	if (image.planar) {
+		const glm::ivec2 chromaSize = getChromaPlaneSize(image);
+		return image.size.x * image.size.y + 2 * chromaSize.x * chromaSize.y;
 	}
+	return image.size.x * image.size.y * fullTextureBytesPerPixel;
+}
 
-	return true;
+glm::ivec2 ImageCache::getChromaPlaneSize(const Image& image) const {
+	return (image.size + image.chromaSubsampling - 1) / image.chromaSubsampling;
+}
+
+void ImageCache::releaseFullTextures(Image& image) {
+	// Textures are kept by the pool to be refilled by the next image of the same size
+	texturePool.release(image.fullTextureId);
+	textureIds.erase(image.fullTextureId);
+	if (image.planar) {
+		texturePool.release(image.chromaTextureIds[0]);
+		texturePool.release(image.chromaTextureIds[1]);
+	}
+	fullResolutionTexturesTotalBytes -= getFullTextureBytes(image);
 }
 
 void ImageCache::processPendingImageQueue() {
-	int maxIterations = 5;
-	int iterations = 0;
+	int fullImageEntries = 0;
 	bool pushedToQueue = false;
-	while (iterations++ < maxIterations) {
-		if (pendingImageQueue.size() == 0 || availablePBOQueue.size() == 0) break;
-
-		ImageQueueEntry imageEntry = pendingImageQueue.front();
-		pendingImageQueue.pop_front();
-		pendingImageQueueIds.erase(imageEntry.imageID);
-		if (
-			(imageEntry.isPreview && images.at(imageEntry.imageID).previewLoaded) ||
-			(!imageEntry.isPreview && images.at(imageEntry.imageID).imageLoaded)) {
-			continue;
-		}
+	// The preview batch receiving slots this frame
+	PreviewBatch* batch = nullptr;
+	while (pendingImageQueue.size() > 0) {
+		ImageQueueEntry& front = pendingImageQueue.front();
+		const Image& image = images.at(front.imageID);
+
+		if (front.isPreview) {
+			if (image.previews[PreviewTier_Small].loaded || previewsInFlight.contains(front.imageID)) {
+				pendingPreviewIds.erase(front.imageID);
+				pendingImageQueue.pop_front();
+				continue;
+			}
 
-		PBOQueueEntry pboEntry = availablePBOQueue.front();
-		availablePBOQueue.pop_front();
-		imageEntry.pbo = pboEntry.pbo;
+			// With the full resolution texture and its mip chain resident, the preview is read back from
+			// a small level instead of decoding the file again. Once the read backs in flight are at their
+			// limit, the file is decoded by a loading thread instead.
+			if (image.imageLoaded && image.mipLevelsGenerated == getMipLevelCount(image) && startMipmapReadback(image)) {
+				pendingPreviewIds.erase(front.imageID);
+				pendingImageQueue.pop_front();
+				continue;
+			}
 
-		const Image& image = images.at(imageEntry.imageID);
-		const unsigned int pboBytes = imageEntry.isPreview ?
-			previewTextureSize.x * previewTextureSize.y * 3 :
-			image.size.x * image.size.y * 3;
+			if (!assignPreviewSlot(front, batch)) break;
+			ImageQueueEntry imageEntry = front;
+			pendingImageQueue.pop_front();
+			pendingPreviewIds.erase(imageEntry.imageID);
+
+			// A full resolution load requested for the same image is taken out of the pending queue and
+			// performed now, producing the preview from the same decode.
+			if (pendingImageQueueIds.contains(imageEntry.imageID) && !image.imageLoaded &&
+				availablePBOQueue.size() > 0 && fullImageEntries < fullImageEntriesPerFrame) {
+				auto fullEntry = std::find_if(pendingImageQueue.begin(), pendingImageQueue.end(), [&imageEntry](const ImageQueueEntry& e) {
+					return e.imageID == imageEntry.imageID && !e.isPreview;
+				});
+				if (fullEntry != pendingImageQueue.end()) {
+					pendingImageQueue.erase(fullEntry);
+					pendingImageQueueIds.erase(imageEntry.imageID);
+					imageEntry.isPreview = false;
+					previewsInFlight.insert(imageEntry.imageID);
+				}
+			}
 
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, imageEntry.pbo);
-		glBufferData(GL_PIXEL_UNPACK_BUFFER, pboBytes, 0, GL_STATIC_DRAW);
-		imageEntry.pboMapping = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			if (!imageEntry.isPreview) {
+				fullImageEntries++;
+				PBOQueueEntry pboEntry = availablePBOQueue.front();
+				availablePBOQueue.pop_front();
+				imageEntry.pbo = pboEntry.pbo;
+				imageEntry.pboMapping = mapPBO(imageEntry.pbo, getFullTextureBytes(image));
+			}
 
-		{
 			std::lock_guard<std::mutex> guard(imageQueueMutex);
 			imageQueue.push_back(imageEntry);
 			pushedToQueue = true;
+		} else {
+			if (image.imageLoaded) {
+				pendingImageQueueIds.erase(front.imageID);
+				pendingImageQueue.pop_front();
+				continue;
+			}
+
+			if (availablePBOQueue.size() == 0 || fullImageEntries == fullImageEntriesPerFrame) break;
+			ImageQueueEntry imageEntry = front;
+			pendingImageQueue.pop_front();
+			pendingImageQueueIds.erase(imageEntry.imageID);
+			fullImageEntries++;
+
+			if (!image.previews[PreviewTier_Small].loaded && !previewsInFlight.contains(imageEntry.imageID)) {
+				attachPreviewToEntry(imageEntry, batch);
+			}
+
+			PBOQueueEntry pboEntry = availablePBOQueue.front();
+			availablePBOQueue.pop_front();
+			imageEntry.pbo = pboEntry.pbo;
+			imageEntry.pboMapping = mapPBO(imageEntry.pbo, getFullTextureBytes(image));
+
+			std::lock_guard<std::mutex> guard(imageQueueMutex);
+			imageQueue.push_back(imageEntry);
+			pushedToQueue = true;
+		}
+	}
+
+	// No more slots are assigned to this frame's batch. An empty batch is returned immediately.
+	if (batch) {
+		if (batch->slotCount == 0) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, batch->pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			batch->mapping = nullptr;
+			batch->state = PreviewBatch::State_Available;
+		} else {
+			batch->state = PreviewBatch::State_Decoding;
 		}
 	}
 
@@ -416,6 +758,67 @@ void ImageCache::processPendingImageQueue() {
 	}
 }
 
+bool ImageCache::attachPreviewToEntry(ImageQueueEntry& entry, PreviewBatch*& batch) {
+	// A preview entry that no thread has started yet already has a batch slot that can be reused.
+	{
+		std::lock_guard<std::mutex> guard(imageQueueMutex);
+		auto previewEntry = std::find_if(imageQueue.begin(), imageQueue.end(), [&entry](const ImageQueueEntry& e) {
+			return e.imageID == entry.imageID && e.isPreview;
+		});
+		if (previewEntry != imageQueue.end()) {
+			entry.previewBatch = previewEntry->previewBatch;
+			entry.previewSlot = previewEntry->previewSlot;
+			imageQueue.erase(previewEntry);
+			previewsInFlight.insert(entry.imageID);
+			return true;
+		}
+	}
+
+	// Otherwise a preview entry still waiting in the pending queue is replaced by a slot in this frame's batch.
+	if (pendingPreviewIds.contains(entry.imageID) && assignPreviewSlot(entry, batch)) {
+		previewsInFlight.insert(entry.imageID);
+		return true;
+	}
+
+	return false;
+}
+
+bool ImageCache::assignPreviewSlot(ImageQueueEntry& entry, PreviewBatch*& batch) {
+	if (!batch) {
+		auto available = std::find_if(previewBatches.begin(), previewBatches.end(), [](const PreviewBatch* b) {
+			return b->state == PreviewBatch::State_Available;
+		});
+		if (available == previewBatches.end()) return false;
+
+		batch = *available;
+		batch->state = PreviewBatch::State_Filling;
+		batch->directoryID = currentDirectoryID;
+		batch->tiers = residentPreviewTiers;
+		batch->slotBytes = getPreviewSlotBytes(residentPreviewTiers);
+		batch->slotCapacity = std::clamp(static_cast<int>(previewBatchBytes / batch->slotBytes), 1, previewBatchCapacity);
+		batch->slotCount = 0;
+		batch->mapping = static_cast<unsigned char*>(mapPBO(batch->pbo, batch->slotCapacity * batch->slotBytes));
+	}
+
+	if (batch->slotCount == batch->slotCapacity) return false;
+
+	int slot = batch->slotCount++;
+	batch->imageIDs[slot] = entry.imageID;
+	batch->slotLoaded[slot] = false;
+	batch->remainingSlots++;
+	entry.previewBatch = batch;
+	entry.previewSlot = slot;
+	return true;
+}
+
+void* ImageCache::mapPBO(unsigned int pbo, unsigned int bytes) {
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, 0, GL_STATIC_DRAW);
+	void* mapping = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return mapping;
+}
+
 void ImageCache::processTextureQueue() {
 	int iterations = 0;
 	while (iterations < textureQueueEntriesPerFrame) {
@@ -434,7 +837,7 @@ void ImageCache::processTextureQueue() {
 		}
 
 		Image& image = images.at(entry.imageID);
-		if (!entry.isPreview && (!imageToLRUNode.contains(image.id) || image.imageLoaded)) {
+		if (!imageToLRUNode.contains(image.id) || image.imageLoaded) {
 			if (!imageToLRUNode.contains(image.id)) {
 				image.imageLoaded = false;
 			}
@@ -445,7 +848,7 @@ void ImageCache::processTextureQueue() {
 		/*
 		There are a few conditions in which the texture entry should be ignored.
 		- If image id is no longer in the LRU list, it must have been evicted in the time that
-		  the image data was being read/decoded (does not apply to previews).
+		  the image data was being read/decoded.
 		- If the image is already loaded, there is no need to do an additional upload.
 		- If the directory ID doesn't match, the entry is leftover from a previous directory.
 		*/
@@ -466,39 +869,270 @@ void ImageCache::processTextureQueue() {
 
 		iterations++;
 
-		GLuint* textureID = entry.isPreview ? &image.previewTextureId : &image.fullTextureId;
-		glm::ivec2& textureSize = entry.isPreview ? image.previewSize : image.size;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, entry.pbo);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		if (image.planar) {
+			// Each plane is uploaded to its own single channel texture from its offset in the PBO
+			const glm::ivec2 chromaSize = getChromaPlaneSize(image);
+			const size_t chromaOffset = static_cast<size_t>(image.size.x) * image.size.y;
+			const size_t chromaBytes = static_cast<size_t>(chromaSize.x) * chromaSize.y;
+
+			image.fullTextureId = texturePool.acquire(image.size, planeTextureFormat);
+			image.chromaTextureIds[0] = texturePool.acquire(chromaSize, planeTextureFormat);
+			image.chromaTextureIds[1] = texturePool.acquire(chromaSize, planeTextureFormat);
+
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			// Pooled textures may hold levels from a previous image, so sampling is limited to the new level 0
+			glBindTexture(GL_TEXTURE_2D, image.fullTextureId);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.size.x, image.size.y, GL_RED, GL_UNSIGNED_BYTE, 0);
+			glBindTexture(GL_TEXTURE_2D, image.chromaTextureIds[0]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaSize.x, chromaSize.y, GL_RED, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(chromaOffset));
+			glBindTexture(GL_TEXTURE_2D, image.chromaTextureIds[1]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, chromaSize.x, chromaSize.y, GL_RED, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(chromaOffset + chromaBytes));
+		} else {
+			image.fullTextureId = texturePool.acquire(image.size, fullTextureFormat);
+			glBindTexture(GL_TEXTURE_2D, image.fullTextureId);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.size.x, image.size.y, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+		}
+
+		pboToFence.emplace(entry.pbo, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		image.imageLoaded = true;
+		image.mipLevelsGenerated = 1;
+		mipmapQueue.push_back(image.id);
+		textureIds.insert(image.fullTextureId);
+		fullResolutionTexturesTotalBytes += getFullTextureBytes(image);
+	}
+}
 
-		glGenTextures(1, textureID);
-		glBindTexture(GL_TEXTURE_2D, *textureID);
+void ImageCache::processMipmapQueue() {
+	u64 texels = 0;
+	while (!mipmapQueue.empty() && texels < mipmapTexelsPerFrame) {
+		Image& image = images.at(mipmapQueue.front());
+		// Images evicted or reloaded since being queued are skipped, a reload queues the image again
+		if (!image.imageLoaded || image.mipLevelsGenerated >= getMipLevelCount(image)) {
+			mipmapQueue.pop_front();
+			continue;
+		}
+
+		const int level = image.mipLevelsGenerated;
+		const glm::ivec2 levelSize = TexturePool::getLevelSize(image.size, level);
+		generateMipLevel(image.fullTextureId, level);
+		texels += static_cast<u64>(levelSize.x) * levelSize.y;
+
+		// Chroma planes are smaller, so their chains end earlier
+		if (image.planar && level < TexturePool::getLevelCount(getChromaPlaneSize(image))) {
+			generateMipLevel(image.chromaTextureIds[0], level);
+			generateMipLevel(image.chromaTextureIds[1], level);
+		}
+		image.mipLevelsGenerated++;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ImageCache::generateMipLevel(GLuint texture, int level) {
+	// Restricting the range to the previous level and this one makes glGenerateMipmap fill only this level.
+	// Afterwards, sampling covers every level generated so far.
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+}
+
+int ImageCache::getMipLevelCount(const Image& image) const {
+	return TexturePool::getLevelCount(image.size);
+}
+
+bool ImageCache::startMipmapReadback(const Image& image) {
+	if (static_cast<int>(mipmapReadbacks.size()) >= maxMipmapReadbacks) return false;
+
+	// The read back level only has to cover the largest tier, since the smaller ones are cascaded from it,
+	// and the image used for analysis
+	PreviewTier largestTier = PreviewTier_Small;
+	for (int tier = 0; tier < PreviewTier_Count; tier++) {
+		if (residentPreviewTiers & (1 << tier)) largestTier = static_cast<PreviewTier>(tier);
+	}
+	const glm::ivec2 coveredSize = glm::max(image.previews[largestTier].contentSize, getLongEdgeSize(image.size, analysisLongEdge));
+	const int level = getCoveringMipLevel(image.size, coveredSize);
+
+	MipmapReadback readback{
+		.imageID = image.id,
+		.pbo = 0,
+		.fence = nullptr,
+		.tiers = residentPreviewTiers,
+		.levelSize = TexturePool::getLevelSize(image.size, level),
+		.chromaLevelSize = glm::ivec2(0, 0)
+	};
+	const size_t levelPixels = static_cast<size_t>(readback.levelSize.x) * readback.levelSize.y;
+
+	// Each plane of a planar image is read at the level closest in size, one after another
+	int chromaLevel = 0;
+	size_t bytes = levelPixels * 3;
+	if (image.planar) {
+		const glm::ivec2 chromaSize = getChromaPlaneSize(image);
+		chromaLevel = getCoveringMipLevel(chromaSize, coveredSize);
+		readback.chromaLevelSize = TexturePool::getLevelSize(chromaSize, chromaLevel);
+		bytes = levelPixels + static_cast<size_t>(readback.chromaLevelSize.x) * readback.chromaLevelSize.y * 2;
+	}
+
+	if (availableReadbackPBOs.empty()) {
+		glGenBuffers(1, &readback.pbo);
+	} else {
+		readback.pbo = availableReadbackPBOs.back();
+		availableReadbackPBOs.pop_back();
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+	glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	// The pixel pointers are offsets into the bound PBO
+	if (image.planar) {
+		const size_t chromaPixels = static_cast<size_t>(readback.chromaLevelSize.x) * readback.chromaLevelSize.y;
+		glBindTexture(GL_TEXTURE_2D, image.fullTextureId);
+		glGetTexImage(GL_TEXTURE_2D, level, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+		glBindTexture(GL_TEXTURE_2D, image.chromaTextureIds[0]);
+		glGetTexImage(GL_TEXTURE_2D, chromaLevel, GL_RED, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(levelPixels));
+		glBindTexture(GL_TEXTURE_2D, image.chromaTextureIds[1]);
+		glGetTexImage(GL_TEXTURE_2D, chromaLevel, GL_RED, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(levelPixels + chromaPixels));
+	} else {
+		glBindTexture(GL_TEXTURE_2D, image.fullTextureId);
+		glGetTexImage(GL_TEXTURE_2D, level, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mipmapReadbacks.push_back(readback);
+	previewsInFlight.insert(image.id);
+	return true;
+}
+
+void ImageCache::processMipmapReadbacks() {
+	int created = 0;
+	// Read backs are issued in order, so they complete in order
+	while (!mipmapReadbacks.empty() && created < mipmapReadbacksPerFrame) {
+		MipmapReadback& readback = mipmapReadbacks.front();
+		if (glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+		glDeleteSync(readback.fence);
+		previewsInFlight.erase(readback.imageID);
+
+		Image& image = images.at(readback.imageID);
+		if (!image.previews[PreviewTier_Small].loaded) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+			const size_t levelPixels = static_cast<size_t>(readback.levelSize.x) * readback.levelSize.y;
+			const size_t chromaPixels = static_cast<size_t>(readback.chromaLevelSize.x) * readback.chromaLevelSize.y;
+			const size_t bytes = image.planar ? levelPixels + chromaPixels * 2 : levelPixels * 3;
+			const unsigned char* data = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT));
+			if (data) {
+				createPreviewFromReadback(image, readback, data);
+				created++;
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+
+		availableReadbackPBOs.push_back(readback.pbo);
+		mipmapReadbacks.pop_front();
+	}
+}
+
+void ImageCache::createPreviewFromReadback(Image& image, const MipmapReadback& readback, const unsigned char* data) {
+	const size_t levelPixels = static_cast<size_t>(readback.levelSize.x) * readback.levelSize.y;
+	const unsigned char* rgbData = data;
+	unsigned char* convertedData = nullptr;
+	if (image.planar) {
+		// Convert to RGB at the Y plane's size
+		const size_t chromaPixels = static_cast<size_t>(readback.chromaLevelSize.x) * readback.chromaLevelSize.y;
+		convertedData = static_cast<unsigned char*>(Arena::allocate(levelPixels * 3));
+		Jpeg::Plane y{ .data = data, .size = readback.levelSize, .stride = readback.levelSize.x };
+		Jpeg::Plane cb{ .data = data + levelPixels, .size = readback.chromaLevelSize, .stride = readback.chromaLevelSize.x };
+		Jpeg::Plane cr{ .data = data + levelPixels + chromaPixels, .size = readback.chromaLevelSize, .stride = readback.chromaLevelSize.x };
+		Jpeg::convertPlanesToRGB(y, cb, cr, convertedData);
+		rgbData = convertedData;
+	}
+
+	unsigned char* previewData = static_cast<unsigned char*>(Arena::allocate(getPreviewSlotBytes(readback.tiers)));
+	writePreviews(image, rgbData, readback.levelSize, previewData, readback.tiers);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	uploadPreviewTextures(image, previewData, readback.tiers);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	Arena::release(previewData);
+	if (convertedData) {
+		Arena::release(convertedData);
+	}
+}
+
+void ImageCache::uploadPreviewTextures(Image& image, const unsigned char* pixels, int tiers) {
+	for (int tier = 0; tier < PreviewTier_Count; tier++) {
+		if ((tiers & (1 << tier)) == 0) continue;
+
+		Preview& preview = image.previews[tier];
+		glGenTextures(1, &preview.textureId);
+		glBindTexture(GL_TEXTURE_2D, preview.textureId);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, preview.size.x, preview.size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels + getPreviewTierOffset(tiers, static_cast<PreviewTier>(tier)));
 
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, entry.pbo);
-		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		preview.loaded = true;
+		previewTexturesTotalBytes += preview.size.x * preview.size.y * 3;
+	}
 
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureSize.x, textureSize.y, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
-		pboToFence.emplace(entry.pbo, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
-		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	if (previewsLoaded.size() < images.size()) {
+		previewsLoaded.insert(image.id);
+	}
+	if (image.hasDifferenceHash) {
+		Similarity::insert(similarityIndex, image.id, image.differenceHash);
+	}
+}
+
+void ImageCache::processPreviewBatches() {
+	for (PreviewBatch* batch : previewBatches) {
+		if (batch->state == PreviewBatch::State_Uploading) {
+			if (glClientWaitSync(batch->fence, 0, 0) == GL_TIMEOUT_EXPIRED) continue;
+			glDeleteSync(batch->fence);
+			batch->fence = nullptr;
+			batch->state = PreviewBatch::State_Available;
+			continue;
+		}
 
-		u64 totalBytes = static_cast<u64>(textureSize.x) * static_cast<u64>(textureSize.y) * 3ULL;
+		if (batch->state != PreviewBatch::State_Decoding || batch->remainingSlots.load(std::memory_order_acquire) > 0) {
+			continue;
+		}
 
-		if (entry.isPreview) {
-			image.previewLoaded = true;
-			if (previewsLoaded.size() < images.size()) {
-				previewsLoaded.insert(image.id);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, batch->pbo);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		batch->mapping = nullptr;
+
+		// Batches left over from a previous directory are discarded without uploading.
+		if (batch->directoryID == currentDirectoryID) {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			for (int slot = 0; slot < batch->slotCount; slot++) {
+				Image& image = images.at(batch->imageIDs[slot]);
+				previewsInFlight.erase(image.id);
+				if (!batch->slotLoaded[slot] || image.previews[PreviewTier_Small].loaded) continue;
+
+				// The pixel pointer is an offset into the bound PBO
+				uploadPreviewTextures(image, reinterpret_cast<const unsigned char*>(static_cast<size_t>(slot) * batch->slotBytes), batch->tiers);
 			}
-			previewTexturesTotalBytes += totalBytes;
-		} else {
-			image.imageLoaded = true;
-			textureIds.insert(*textureID);
-			fullResolutionTexturesTotalBytes += totalBytes;
+			glBindTexture(GL_TEXTURE_2D, 0);
 		}
+
+		batch->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		batch->state = PreviewBatch::State_Uploading;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	}
 }
 
@@ -537,6 +1171,31 @@ void ImageCache::useImageFullTexture(int id) {
 	useImagesFullTextures(ids);
 }
 
+void ImageCache::prioritizeImage(int id) {
+	auto isFullEntry = [id](const ImageQueueEntry& e) {
+		return e.imageID == id && !e.isPreview;
+	};
+
+	auto pending = std::find_if(pendingImageQueue.begin(), pendingImageQueue.end(), isFullEntry);
+	if (pending != pendingImageQueue.end()) {
+		ImageQueueEntry entry = *pending;
+		entry.highPriority = true;
+		pendingImageQueue.erase(pending);
+		pendingImageQueue.push_front(entry);
+		return;
+	}
+
+	// The entry may already have a PBO and be waiting for an image loading thread
+	std::lock_guard<std::mutex> guard(imageQueueMutex);
+	auto queued = std::find_if(imageQueue.begin(), imageQueue.end(), isFullEntry);
+	if (queued != imageQueue.end()) {
+		ImageQueueEntry entry = *queued;
+		entry.highPriority = true;
+		imageQueue.erase(queued);
+		imageQueue.push_front(entry);
+	}
+}
+
 void ImageCache::useImagesFullTextures(std::vector<int>& allIds) {
 	// Reduce the number of image ids to add to a set that is <= the cache capacity. Any more
 	// will result in the last images in the list evicting the first images in the list.
@@ -556,7 +1215,10 @@ void ImageCache::useImagesFullTextures(std::vector<int>& allIds) {
 			.directoryID = currentDirectoryID,
 			.pbo = 0,
 			.pboMapping = nullptr,
-			.isPreview = false
+			.isPreview = false,
+			.previewBatch = nullptr,
+			.previewSlot = 0,
+			.highPriority = false
 		};
 		pendingImageQueue.push_back(entry);
 		pendingImageQueueIds.insert(entry.imageID);
@@ -664,9 +1326,7 @@ void ImageCache::deleteImage(int id) {
 
 	if (image.imageLoaded) {
 		image.imageLoaded = false;
-		glDeleteTextures(1, &image.fullTextureId);
-		textureIds.erase(image.fullTextureId);
-		fullResolutionTexturesTotalBytes -= static_cast<u64>(image.size.x) * static_cast<u64>(image.size.y) * 3ULL;
+		releaseFullTextures(image);
 	}
 
 	imageToLRUNode.erase(id);
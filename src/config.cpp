@@ -59,6 +59,8 @@ namespace Config {
 						config.cacheBackwardPreload = intValue.value();
 					} else if (key == "cacheForwardPreload" && intValue.has_value()) {
 						config.cacheForwardPreload = intValue.value();
+					} else if (key == "previewTiers" && intValue.has_value()) {
+						config.previewTiers = intValue.value();
 					}
 				}
 			}
@@ -80,6 +82,7 @@ namespace Config {
 		stream << "cacheCapacity = " << config.cacheCapacity << std::endl;
 		stream << "cacheBackwardPreload = " << config.cacheBackwardPreload << std::endl;
 		stream << "cacheForwardPreload = " << config.cacheForwardPreload << std::endl;
+		stream << "previewTiers = " << config.previewTiers << std::endl;
 
 		stream.close();
 	}
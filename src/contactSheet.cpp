@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <glm/gtc/type_ptr.hpp>
+#include "contactSheet.h"
+#include "orientation.h"
+
+ContactSheet::ContactSheet(const ImageCache& imageCache)
+	: imageCache(imageCache), images(imageCache.getImages()) {
+	// Unit quad, with one corner per vertex from the top left
+	float quad[] = {
+		0.0f, 0.0f,
+		1.0f, 0.0f,
+		0.0f, 1.0f,
+		1.0f, 1.0f,
+	};
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &quadVBO);
+	glGenBuffers(1, &instanceVBO);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+	int cornerIndex = 0;
+	glVertexAttribPointer(cornerIndex, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+	glEnableVertexAttribArray(cornerIndex);
+
+	// The remaining attributes advance once per tile
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	const GLsizei stride = sizeof(TileInstance);
+
+	int rectIndex = 1;
+	glVertexAttribPointer(rectIndex, 4, GL_FLOAT, GL_FALSE, stride, (void*) offsetof(TileInstance, rect));
+	glVertexAttribDivisor(rectIndex, 1);
+	glEnableVertexAttribArray(rectIndex);
+
+	int uvRectIndex = 2;
+	glVertexAttribPointer(uvRectIndex, 4, GL_FLOAT, GL_FALSE, stride, (void*) offsetof(TileInstance, uvRect));
+	glVertexAttribDivisor(uvRectIndex, 1);
+	glEnableVertexAttribArray(uvRectIndex);
+
+	int contentScaleIndex = 3;
+	glVertexAttribPointer(contentScaleIndex, 2, GL_FLOAT, GL_FALSE, stride, (void*) offsetof(TileInstance, contentScale));
+	glVertexAttribDivisor(contentScaleIndex, 1);
+	glEnableVertexAttribArray(contentScaleIndex);
+
+	int stateIndex = 4;
+	glVertexAttribIPointer(stateIndex, 3, GL_INT, stride, (void*) offsetof(TileInstance, state));
+	glVertexAttribDivisor(stateIndex, 1);
+	glEnableVertexAttribArray(stateIndex);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	glGenFramebuffers(1, &copyFramebuffer);
+
+	buildShaders();
+}
+
+ContactSheet::~ContactSheet() {
+	glDeleteProgram(program);
+	glDeleteBuffers(1, &quadVBO);
+	glDeleteBuffers(1, &instanceVBO);
+	glDeleteVertexArrays(1, &vao);
+	glDeleteFramebuffers(1, &copyFramebuffer);
+	if (atlasTexture != 0) {
+		glDeleteTextures(1, &atlasTexture);
+	}
+}
+
+void ContactSheet::update(double elapsed) {
+	const float step = std::min(1.0f, animationLag * static_cast<float>(elapsed));
+
+	if (tileSize != targetTileSize) {
+		// The tile under the zoom position, and the position within its row, stay in place as the columns change
+		const float pitch = tileSize + tileSpacing;
+		const glm::vec2 local = zoomPosition - sheetPosition;
+		const int row = std::max(0, static_cast<int>((local.y + scrollOffset - tileSpacing) / pitch));
+		const float rowFraction = (local.y + scrollOffset - tileSpacing - row * pitch) / pitch;
+		const int column = std::clamp(static_cast<int>((local.x - getColumnsOffset(tileSize, columns)) / pitch), 0, columns - 1);
+		const int anchorIndex = row * columns + column;
+
+		if (std::abs(targetTileSize - tileSize) <= 0.5f) {
+			tileSize = targetTileSize;
+		} else {
+			tileSize += (targetTileSize - tileSize) * step;
+		}
+
+		columns = getColumnCount(tileSize);
+		const float newPitch = tileSize + tileSpacing;
+		scrollOffset = tileSpacing + (anchorIndex / columns + rowFraction) * newPitch - local.y;
+		targetScrollOffset = scrollOffset;
+	} else if (scrollOffset != targetScrollOffset) {
+		if (std::abs(targetScrollOffset - scrollOffset) <= 0.5f) {
+			scrollOffset = targetScrollOffset;
+		} else {
+			scrollOffset += (targetScrollOffset - scrollOffset) * step;
+		}
+	}
+
+	clampScroll();
+}
+
+bool ContactSheet::isAnimating() const {
+	return tileSize != targetTileSize || scrollOffset != targetScrollOffset || copyBacklog > 0;
+}
+
+void ContactSheet::layout(glm::vec2 position, glm::vec2 size, const std::vector<int>& ids, int selectedID, int hoveredID) {
+	const PreviewTier tier = getTileTier();
+	if (atlasTexture == 0 || tier != atlasTier) {
+		createAtlas(tier);
+	}
+
+	frame++;
+	sheetPosition = position;
+	sheetSize = glm::max(size, glm::vec2(1.0f));
+	shownIDs.assign(ids.begin(), ids.end());
+	columns = getColumnCount(tileSize);
+	clampScroll();
+
+	const float pitch = tileSize + tileSpacing;
+
+	// Keyboard navigation moves the selection, which should stay in view
+	if (selectedID != lastSelectedID) {
+		lastSelectedID = selectedID;
+		auto selected = std::find(shownIDs.begin(), shownIDs.end(), selectedID);
+		if (selected != shownIDs.end()) {
+			const float rowTop = tileSpacing + ((selected - shownIDs.begin()) / columns) * pitch;
+			if (rowTop - tileSpacing < targetScrollOffset) {
+				targetScrollOffset = rowTop - tileSpacing;
+			} else if (rowTop + tileSize + tileSpacing > targetScrollOffset + sheetSize.y) {
+				targetScrollOffset = rowTop + tileSize + tileSpacing - sheetSize.y;
+			}
+			clampScroll();
+		}
+	}
+
+	// Only the rows in view are laid out
+	instances.clear();
+	copyBacklog = 0;
+	const int firstRow = std::max(0, static_cast<int>((scrollOffset - tileSpacing) / pitch));
+	const int lastRow = static_cast<int>((scrollOffset + sheetSize.y) / pitch);
+	const float columnsOffset = getColumnsOffset(tileSize, columns);
+	const int firstIndex = firstRow * columns;
+	const int endIndex = std::min(static_cast<int>(shownIDs.size()), (lastRow + 1) * columns);
+
+	for (int index = firstIndex; index < endIndex; index++) {
+		auto entry = images.find(shownIDs[index]);
+		if (entry == images.end()) continue;
+		const Image& image = entry->second;
+
+		TileInstance tile{
+			.rect = glm::vec4(
+				columnsOffset + (index % columns) * pitch,
+				tileSpacing + (index / columns) * pitch - scrollOffset,
+				tileSize,
+				tileSize),
+			.uvRect = glm::vec4(0.0f),
+			.contentScale = glm::vec2(1.0f),
+			.state = glm::ivec3(-1, image.orientation, 0)
+		};
+
+		if (image.id == selectedID) tile.state.z |= TileFlag_Selected;
+		if (image.id == hoveredID) tile.state.z |= TileFlag_Hovered;
+		if (image.saved) tile.state.z |= TileFlag_Saved;
+		if (image.skipped) tile.state.z |= TileFlag_Skipped;
+
+		// The content is fit within the square tile in its displayed orientation
+		const Preview& preview = image.previews[atlasTier];
+		const glm::vec2 displaySize = glm::vec2(Orientation::getDisplaySize(preview.contentSize, image.orientation));
+		if (displaySize.x > 0 && displaySize.y > 0) {
+			tile.contentScale = displaySize / std::max(displaySize.x, displaySize.y);
+		}
+
+		if (preview.loaded) {
+			const int slot = acquireSlot(image);
+			if (slot == -1) {
+				copyBacklog++;
+			} else {
+				const int slotsInLayer = slotsPerLayer.x * slotsPerLayer.y;
+				const int slotInLayer = slot % slotsInLayer;
+				const glm::vec2 slotOrigin = glm::vec2(slotInLayer % slotsPerLayer.x, slotInLayer / slotsPerLayer.x) * glm::vec2(slotSize);
+				tile.uvRect = glm::vec4(
+					(slotOrigin + glm::vec2(preview.contentOffset)) / static_cast<float>(atlasLayerSize),
+					glm::vec2(preview.contentSize) / static_cast<float>(atlasLayerSize));
+				tile.state.x = slot / slotsInLayer;
+			}
+		}
+
+		instances.push_back(tile);
+	}
+}
+
+void ContactSheet::draw(ImDrawList* drawList) {
+	drawList->AddCallback(&ContactSheet::drawCallback, this);
+	drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void ContactSheet::scroll(int offset) {
+	targetScrollOffset -= offset * scrollSpeed * (tileSize + tileSpacing);
+	clampScroll();
+}
+
+void ContactSheet::zoom(int offset, glm::vec2 position) {
+	targetTileSize = std::clamp(targetTileSize * powf(zoomSpeed, static_cast<float>(offset)), minTileSize, maxTileSize);
+	zoomPosition = position;
+}
+
+int ContactSheet::getImageAt(glm::vec2 position) const {
+	const glm::vec2 local = position - sheetPosition;
+	if (local.x < 0 || local.y < 0 || local.x >= sheetSize.x || local.y >= sheetSize.y) return -1;
+
+	// Positions in the gaps between tiles don't belong to any image
+	const float pitch = tileSize + tileSpacing;
+	const glm::vec2 grid(local.x - getColumnsOffset(tileSize, columns), local.y + scrollOffset - tileSpacing);
+	if (grid.x < 0 || grid.y < 0) return -1;
+	const int column = static_cast<int>(grid.x / pitch);
+	const int row = static_cast<int>(grid.y / pitch);
+	if (column >= columns || grid.x - column * pitch > tileSize || grid.y - row * pitch > tileSize) return -1;
+
+	const size_t index = static_cast<size_t>(row) * columns + column;
+	return index < shownIDs.size() ? shownIDs[index] : -1;
+}
+
+void ContactSheet::clear() {
+	imageSlots.clear();
+	std::fill(slotImages.begin(), slotImages.end(), -1);
+	std::fill(slotLastUsed.begin(), slotLastUsed.end(), 0);
+	freeSlots.clear();
+	for (int slot = static_cast<int>(slotImages.size()) - 1; slot >= 0; slot--) {
+		freeSlots.push_back(slot);
+	}
+	pendingCopies.clear();
+	instances.clear();
+	shownIDs.clear();
+	lastSelectedID = -1;
+	scrollOffset = 0.0f;
+	targetScrollOffset = 0.0f;
+	copyBacklog = 0;
+}
+
+void ContactSheet::createAtlas(PreviewTier tier) {
+	if (atlasTexture != 0) {
+		glDeleteTextures(1, &atlasTexture);
+	}
+
+	atlasTier = tier;
+	slotSize = imageCache.getPreviewTextureSize(tier);
+	slotsPerLayer = glm::ivec2(atlasLayerSize) / slotSize;
+	const int slotsInLayer = slotsPerLayer.x * slotsPerLayer.y;
+	const int layerCount = std::max(minAtlasLayerCount, (minAtlasSlots + slotsInLayer - 1) / slotsInLayer);
+	const int slotCount = slotsInLayer * layerCount;
+
+	glGenTextures(1, &atlasTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, atlasTexture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, atlasLayerSize, atlasLayerSize, layerCount, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	imageSlots.clear();
+	pendingCopies.clear();
+	slotImages.assign(slotCount, -1);
+	slotLastUsed.assign(slotCount, 0);
+	freeSlots.clear();
+	for (int slot = slotCount - 1; slot >= 0; slot--) {
+		freeSlots.push_back(slot);
+	}
+}
+
+PreviewTier ContactSheet::getTileTier() const {
+	// The target size is used so the tier changes once per zoom rather than during its animation
+	const float tilePixels = targetTileSize * ImGui::GetIO().DisplayFramebufferScale.x;
+	const int tiers = imageCache.getResidentPreviewTiers();
+	PreviewTier tier = PreviewTier_Small;
+	for (int candidate = 0; candidate < PreviewTier_Count; candidate++) {
+		if ((tiers & (1 << candidate)) == 0) continue;
+		tier = static_cast<PreviewTier>(candidate);
+		if (imageCache.getPreviewTextureSize(tier).x >= tilePixels) break;
+	}
+	return tier;
+}
+
+int ContactSheet::acquireSlot(const Image& image) {
+	auto existing = imageSlots.find(image.id);
+	if (existing != imageSlots.end()) {
+		slotLastUsed[existing->second] = frame;
+		return existing->second;
+	}
+
+	if (static_cast<int>(pendingCopies.size()) >= maxCopiesPerFrame) return -1;
+
+	if (freeSlots.empty()) {
+		// Slots not in view this frame become candidates for reuse, with the least recently used at the back
+		for (int slot = 0; slot < slotImages.size(); slot++) {
+			if (slotLastUsed[slot] < frame) {
+				freeSlots.push_back(slot);
+			}
+		}
+		std::sort(freeSlots.begin(), freeSlots.end(), [this](int a, int b) { return slotLastUsed[a] > slotLastUsed[b]; });
+	}
+
+	while (!freeSlots.empty()) {
+		const int slot = freeSlots.back();
+		freeSlots.pop_back();
+		// Candidates may have come back into view since they were collected
+		if (slotImages[slot] != -1) {
+			if (slotLastUsed[slot] == frame) continue;
+			imageSlots.erase(slotImages[slot]);
+		}
+
+		slotImages[slot] = image.id;
+		slotLastUsed[slot] = frame;
+		imageSlots[image.id] = slot;
+		pendingCopies.emplace_back(slot, image.id);
+		return slot;
+	}
+	return -1;
+}
+
+void ContactSheet::clampScroll() {
+	const int rows = (static_cast<int>(shownIDs.size()) + columns - 1) / columns;
+	const float contentHeight = rows * (tileSize + tileSpacing) + tileSpacing;
+	const float maxScroll = std::max(0.0f, contentHeight - sheetSize.y);
+	scrollOffset = std::clamp(scrollOffset, 0.0f, maxScroll);
+	targetScrollOffset = std::clamp(targetScrollOffset, 0.0f, maxScroll);
+}
+
+int ContactSheet::getColumnCount(float size) const {
+	return std::max(1, static_cast<int>((sheetSize.x - tileSpacing) / (size + tileSpacing)));
+}
+
+float ContactSheet::getColumnsOffset(float size, int columnCount) const {
+	const float columnsWidth = columnCount * (size + tileSpacing) - tileSpacing;
+	return std::max(tileSpacing, (sheetSize.x - columnsWidth) / 2.0f);
+}
+
+void ContactSheet::drawCallback(const ImDrawList* drawList, const ImDrawCmd* command) {
+	static_cast<ContactSheet*>(command->UserCallbackData)->renderTiles(command->ClipRect);
+}
+
+void ContactSheet::renderTiles(const ImVec4& clipRect) {
+	// Previews assigned a slot during layout are copied into the atlas before any tile reads it
+	if (!pendingCopies.empty()) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, copyFramebuffer);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, atlasTexture);
+		const int slotsInLayer = slotsPerLayer.x * slotsPerLayer.y;
+		for (const auto& [slot, id] : pendingCopies) {
+			auto image = images.find(id);
+			if (slotImages[slot] != id || image == images.end() || !image->second.previews[atlasTier].loaded) continue;
+
+			const int slotInLayer = slot % slotsInLayer;
+			const glm::ivec2 slotOrigin = glm::ivec2(slotInLayer % slotsPerLayer.x, slotInLayer / slotsPerLayer.x) * slotSize;
+			glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image->second.previews[atlasTier].textureId, 0);
+			glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, slotOrigin.x, slotOrigin.y, slot / slotsInLayer, 0, 0, slotSize.x, slotSize.y);
+		}
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		pendingCopies.clear();
+	}
+
+	const ImDrawData* drawData = ImGui::GetDrawData();
+	const glm::vec2 displayPosition(drawData->DisplayPos.x, drawData->DisplayPos.y);
+	const glm::vec2 scale(drawData->FramebufferScale.x, drawData->FramebufferScale.y);
+	const float framebufferHeight = drawData->DisplaySize.y * scale.y;
+
+	glm::vec2 clipMin = glm::max(sheetPosition, glm::vec2(clipRect.x, clipRect.y));
+	glm::vec2 clipMax = glm::min(sheetPosition + sheetSize, glm::vec2(clipRect.z, clipRect.w));
+	if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) return;
+	clipMin = (clipMin - displayPosition) * scale;
+	clipMax = (clipMax - displayPosition) * scale;
+
+	// GL window coordinates start at the bottom left, while ImGui's start at the top left
+	const glm::vec2 viewportMin = (sheetPosition - displayPosition) * scale;
+	const glm::vec2 viewportSize = sheetSize * scale;
+	glViewport(static_cast<int>(viewportMin.x), static_cast<int>(framebufferHeight - viewportMin.y - viewportSize.y), static_cast<int>(viewportSize.x), static_cast<int>(viewportSize.y));
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(static_cast<int>(clipMin.x), static_cast<int>(framebufferHeight - clipMax.y), static_cast<int>(clipMax.x - clipMin.x), static_cast<int>(clipMax.y - clipMin.y));
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	if (instances.empty()) return;
+
+	// Every tile in view is drawn by a single instanced call
+	glUseProgram(program);
+	glUniform2f(viewSizeLocation, sheetSize.x, sheetSize.y);
+	glActiveTexture(GL_TEXTURE0 + atlasTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, atlasTexture);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	// The buffer is orphaned each frame so the upload doesn't wait on the previous frame's draw
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(TileInstance), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(TileInstance), instances.data());
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instances.size()));
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void ContactSheet::buildShaders() {
+	const char* vertexShaderSource = R"(
+		#version 330 core
+		layout (location = 0) in vec2 corner;
+		layout (location = 1) in vec4 rect;
+		layout (location = 2) in vec4 in_uvRect;
+		layout (location = 3) in vec2 in_contentScale;
+		layout (location = 4) in ivec3 in_state;
+		// Position within the tile in pixels, from the top left
+		out vec2 tilePosition;
+		flat out vec2 tileSize;
+		flat out vec4 uvRect;
+		flat out vec2 contentScale;
+		flat out ivec3 state;
+		// Size of the sheet in pixels, which tile rects are relative to
+		uniform vec2 viewSize;
+		void main() {
+			tilePosition = corner * rect.zw;
+			tileSize = rect.zw;
+			uvRect = in_uvRect;
+			contentScale = in_contentScale;
+			state = in_state;
+			vec2 pixel = rect.xy + tilePosition;
+			gl_Position = vec4(pixel.x / viewSize.x * 2.0 - 1.0, 1.0 - pixel.y / viewSize.y * 2.0, 0.0, 1.0);
+		}
+	)";
+
+	const char* fragmentShaderSource = R"(
+		#version 330 core
+		in vec2 tilePosition;
+		flat in vec2 tileSize;
+		flat in vec4 uvRect;
+		flat in vec2 contentScale;
+		// Atlas layer, EXIF orientation, and flags
+		flat in ivec3 state;
+		out vec4 color;
+		uniform sampler2DArray atlas;
+		// Display to texture transforms, indexed by EXIF orientation
+		uniform mat3 orientations[9];
+		const int selectedFlag = 1;
+		const int hoveredFlag = 2;
+		const int savedFlag = 4;
+		const int skippedFlag = 8;
+		const float borderWidth = 3.0;
+		const vec3 backgroundColor = vec3(0.14, 0.14, 0.14);
+		const vec3 placeholderColor = vec3(0.25, 0.25, 0.25);
+		const vec3 selectedColor = vec3(1.0, 1.0, 1.0);
+		const vec3 savedColor = vec3(0.27, 0.68, 0.28);
+
+		void main() {
+			vec2 content = (tilePosition / tileSize - 0.5) / contentScale + 0.5;
+			if (any(lessThan(content, vec2(0.0))) || any(greaterThan(content, vec2(1.0)))) {
+				color = vec4(backgroundColor, 1.0);
+			} else if (state.x < 0) {
+				color = vec4(placeholderColor, 1.0);
+			} else {
+				// Clamped half a texel inside the content so that neighboring slots don't bleed in
+				vec2 halfTexel = 0.5 / vec2(textureSize(atlas, 0).xy);
+				vec2 uv = uvRect.xy + uvRect.zw * (orientations[state.y] * vec3(content, 1.0)).xy;
+				uv = clamp(uv, uvRect.xy + halfTexel, uvRect.xy + uvRect.zw - halfTexel);
+				color = vec4(texture(atlas, vec3(uv, float(state.x))).rgb, 1.0);
+			}
+
+			if ((state.z & skippedFlag) != 0) {
+				color.rgb *= 0.35;
+			}
+			if ((state.z & hoveredFlag) != 0) {
+				color.rgb = mix(color.rgb, vec3(1.0), 0.1);
+			}
+
+			// Saved tiles have a border inside the selection border
+			vec2 edge = min(tilePosition, tileSize - tilePosition);
+			float edgeDistance = min(edge.x, edge.y);
+			bool selected = (state.z & selectedFlag) != 0;
+			if (selected && edgeDistance < borderWidth) {
+				color.rgb = selectedColor;
+			} else if ((state.z & savedFlag) != 0 && edgeDistance < borderWidth * (selected ? 2.0 : 1.0)) {
+				color.rgb = savedColor;
+			}
+		}
+	)";
+
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+
+	GLint compilationSuccess;
+	glCompileShader(vertexShader);
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compilationSuccess);
+	if (!compilationSuccess) {
+		GLint maxLength;
+		glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetShaderInfoLog(vertexShader, maxLength, &maxLength, errorLog.data());
+		std::cout << "Failed to compile contact sheet vertex shader:\n" << errorLog << std::endl;
+	}
+
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
+
+	glCompileShader(fragmentShader);
+	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compilationSuccess);
+	if (!compilationSuccess) {
+		GLint maxLength;
+		glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, errorLog.data());
+		std::cout << "Failed to compile contact sheet fragment shader:\n" << errorLog << std::endl;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	GLint linkSuccess;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkSuccess);
+	if (!linkSuccess) {
+		GLint maxLength;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetProgramInfoLog(program, maxLength, &maxLength, errorLog.data());
+		std::cout << "Failed to link contact sheet program:\n" << errorLog << std::endl;
+	}
+
+	viewSizeLocation = glGetUniformLocation(program, "viewSize");
+
+	// Orientations and the atlas texture unit don't change, so they are set once
+	glm::mat3 orientations[9];
+	for (int orientation = 0; orientation < 9; orientation++) {
+		orientations[orientation] = Orientation::getDisplayToTexture(orientation);
+	}
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "atlas"), atlasTextureUnit);
+	glUniformMatrix3fv(glGetUniformLocation(program, "orientations"), 9, GL_FALSE, glm::value_ptr(orientations[0]));
+
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+}
@@ -1,55 +0,0 @@
-#include <iostream>
-#include "frame_buffer.h"
-
-FrameBuffer::FrameBuffer() : FrameBuffer(1, 1) {}
-
-FrameBuffer::FrameBuffer(int width, int height) {
-	glGenFramebuffers(1, &fbo);
-	glGenTextures(1, &texture);
-	glGenRenderbuffers(1, &rbo);
-	update(width, height);
-}
-
-FrameBuffer::~FrameBuffer() {
-	glDeleteFramebuffers(1, &fbo);
-	glDeleteTextures(1, &texture);
-	glDeleteRenderbuffers(1, &rbo);
-}
-
-GLuint FrameBuffer::getTextureId() {
-	return texture;
-}
-
-void FrameBuffer::update(int width, int height) {
-	// Update texture
-	glActiveTexture(textureUnit);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	// Update render buffer
-	glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-	glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-	// Update frame buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Failed to create frame buffer (error " << glCheckFramebufferStatus(GL_FRAMEBUFFER) << ")" << std::endl;
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void FrameBuffer::bind() {
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-}
-
-void FrameBuffer::unbind() {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
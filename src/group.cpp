@@ -1,91 +1,305 @@
 #include <algorithm>
-#include <functional>
-#include <iostream>
-#include <time.h>
+#include <bit>
+#include <cmath>
+#include <string>
 #include "group.h"
 
 namespace Group {
-	// Forward declarations
-	void applyTimeSplits(std::vector<ImageGroup>& groups, int seconds, const std::map<int, Image>& images);
-
-	void updateSavedSkippedCounts(std::vector<ImageGroup>& groups, const std::map<int, Image>& images) {
-		for (ImageGroup& group : groups) {
-			group.savedCount = 0;
-			group.skippedCount = 0;
-			for (int id : group.ids) {
-				if (images.at(id).saved) {
-					group.savedCount++;
-				} else if (images.at(id).skipped) {
-					group.skippedCount++;
+	namespace {
+		int getStringKey(std::unordered_map<std::string, int>& keys, const std::optional<std::string>& value) {
+			if (!value.has_value() || value->empty()) return -1;
+			auto [entry, inserted] = keys.try_emplace(value.value(), static_cast<int>(keys.size()));
+			return entry->second;
+		}
+
+		bool differentKeys(int a, int b) {
+			return a != -1 && b != -1 && a != b;
+		}
+
+		// Checks whether a criterion other than time starts a new group at `next`, the image after `current`.
+		bool shouldSplitWithoutTime(const GroupingIndex& index, const GroupParameters& parameters, size_t current, size_t next) {
+			if (parameters.cameraEnabled && differentKeys(index.cameras[current], index.cameras[next])) {
+				return true;
+			}
+			if (parameters.lensEnabled && differentKeys(index.lenses[current], index.lenses[next])) {
+				return true;
+			}
+			if (parameters.focalLengthEnabled && index.focalLengths[current] > 0.0f && index.focalLengths[next] > 0.0f &&
+				std::abs(index.focalLengths[next] - index.focalLengths[current]) >= parameters.focalLengthMillimeters) {
+				return true;
+			}
+			if (parameters.similarityEnabled && index.hasHash[current] && index.hasHash[next] &&
+				std::popcount(index.hashes[current] ^ index.hashes[next]) >= parameters.similarityBits) {
+				return true;
+			}
+			return false;
+		}
+
+		void buildSplits(GroupingIndex& index, const GroupParameters& parameters) {
+			const size_t pairCount = index.ids.empty() ? 0 : index.ids.size() - 1;
+			index.splitWithoutTime.assign(pairCount, false);
+			index.gaps.assign(pairCount, GroupingIndex::noGap);
+			index.sortedGaps.clear();
+			index.splitWithoutTimeCount = 0;
+
+			for (size_t i = 0; i < pairCount; i++) {
+				if (shouldSplitWithoutTime(index, parameters, i, i + 1)) {
+					index.splitWithoutTime[i] = true;
+					index.splitWithoutTimeCount++;
+				} else if (index.hasTimestamp[i] && index.hasTimestamp[i + 1]) {
+					// Gaps between images that are already split can't change the groups, so they aren't counted
+					index.gaps[i] = index.timestamps[i + 1] - index.timestamps[i];
+					index.sortedGaps.push_back(index.gaps[i]);
+				}
+			}
+			std::sort(index.sortedGaps.begin(), index.sortedGaps.end());
+			index.parameters = parameters;
+		}
+
+		// Walks the columns once, closing the current group at each split point.
+		void splitGroups(std::vector<ImageGroup>& groups, const GroupingIndex& index, const GroupParameters& parameters) {
+			groups.clear();
+			if (index.ids.empty()) {
+				groups.push_back(ImageGroup{ .ids = {}, .savedCount = 0, .skippedCount = 0 });
+				return;
+			}
+
+			size_t groupStart = 0;
+			int savedCount = 0;
+			int skippedCount = 0;
+			for (size_t i = 0; i < index.ids.size(); i++) {
+				if (index.images[i]->saved) {
+					savedCount++;
+				} else if (index.images[i]->skipped) {
+					skippedCount++;
+				}
+
+				const bool lastImage = i + 1 == index.ids.size();
+				if (lastImage || index.splitWithoutTime[i] || (parameters.timeEnabled && index.gaps[i] >= parameters.timeSeconds)) {
+					groups.push_back(ImageGroup{
+						.ids = {index.ids.begin() + groupStart, index.ids.begin() + i + 1},
+						.savedCount = savedCount,
+						.skippedCount = skippedCount
+					});
+					groupStart = i + 1;
+					savedCount = 0;
+					skippedCount = 0;
+				}
+			}
+		}
+
+		void addToTree(std::vector<int>& tree, int position, int value) {
+			for (size_t i = position + 1; i < tree.size(); i += i & (~i + 1)) {
+				tree[i] += value;
+			}
+		}
+
+		// Sum of the values at positions [0, count)
+		int prefixSum(const std::vector<int>& tree, int count) {
+			int sum = 0;
+			for (int i = count; i > 0; i -= i & -i) {
+				sum += tree[i];
+			}
+			return sum;
+		}
+
+		// Position of the k-th unskipped image, counting from 1, or -1 if there are fewer than k.
+		int findKth(const std::vector<int>& tree, int k) {
+			const int size = static_cast<int>(tree.size()) - 1;
+			if (k < 1) return -1;
+
+			int step = 1;
+			while (step * 2 <= size) {
+				step *= 2;
+			}
+
+			// Descend to the largest prefix with fewer than k images, the k-th is the position after it
+			int prefix = 0;
+			for (; step > 0; step >>= 1) {
+				if (prefix + step <= size && tree[prefix + step] < k) {
+					prefix += step;
+					k -= tree[prefix];
 				}
 			}
+			return prefix < size ? prefix : -1;
 		}
 	}
 
-	void generateInitialGroup(std::vector<ImageGroup>& groups, const std::map<int, Image>& images) {
-		groups.clear();
+	void sortGroup(ImageGroup& group, GroupSort sort, const std::map<int, Image>& images) {
+		// Look up each image once rather than in every comparison
+		std::vector<const Image*> groupImages;
+		groupImages.reserve(group.ids.size());
+		for (int id : group.ids) {
+			groupImages.push_back(&images.at(id));
+		}
 
-		ImageGroup initialGroup = {
-			.ids = {},
-			.savedCount = 0,
-			.skippedCount = 0
-		};
-		for (const auto& [id, image] : images) {
-			initialGroup.ids.push_back(id);
+		switch (sort) {
+		case GroupSort_Filename:
+			std::sort(groupImages.begin(), groupImages.end(), [](const Image* a, const Image* b) {
+				return a->filename.compare(b->filename) < 0;
+			});
+			break;
+		case GroupSort_Sharpness:
+			// Images without a score go last, in their current order
+			std::stable_sort(groupImages.begin(), groupImages.end(), [](const Image* a, const Image* b) {
+				if (a->hasSharpness != b->hasSharpness) return a->hasSharpness;
+				return a->sharpness > b->sharpness;
+			});
+			break;
 		}
 
+		for (size_t i = 0; i < groupImages.size(); i++) {
+			group.ids[i] = groupImages[i]->id;
+		}
+	}
+
+	void buildGroupingIndex(GroupingIndex& index, const GroupParameters& parameters, const std::map<int, Image>& images) {
+		// Sort by filename once, through pointers to the names rather than by looking up each id
+		std::vector<std::pair<const std::string*, const Image*>> order;
+		order.reserve(images.size());
+		for (const auto& [id, image] : images) {
+			order.emplace_back(&image.filename, &image);
+		}
 		// TODO: handle other baseline sorting options
-		std::sort(initialGroup.ids.begin(), initialGroup.ids.end(), [&images](int a, int b) {
-			return images.at(a).filename.compare(images.at(b).filename) < 0;
-			});
+		std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+			return a.first->compare(*b.first) < 0;
+		});
 
-		groups.push_back(initialGroup);
-		updateSavedSkippedCounts(groups, images);
+		const size_t count = order.size();
+		index.images.resize(count);
+		index.ids.resize(count);
+		index.timestamps.resize(count);
+		index.hasTimestamp.resize(count);
+		index.cameras.resize(count);
+		index.lenses.resize(count);
+		index.focalLengths.resize(count);
+		index.hashes.resize(count);
+		index.hasHash.resize(count);
+
+		std::unordered_map<std::string, int> cameraKeys;
+		std::unordered_map<std::string, int> lensKeys;
+		for (size_t i = 0; i < count; i++) {
+			const Image& image = *order[i].second;
+			const ImageMetadata& metadata = image.metadata;
+			index.images[i] = &image;
+			index.ids[i] = image.id;
+			index.hashes[i] = image.differenceHash;
+			index.hasHash[i] = image.hasDifferenceHash;
+			index.hasTimestamp[i] = metadata.timestamp.has_value();
+			index.timestamps[i] = metadata.timestamp.has_value() ? metadata.timestamp->secondsSinceEpoch : 0;
+			index.lenses[i] = getStringKey(lensKeys, metadata.lensModel);
+			index.focalLengths[i] = metadata.focalLength.has_value() && metadata.focalLength.value() > 0.0
+				? static_cast<float>(metadata.focalLength.value())
+				: -1.0f;
+
+			// Model names aren't unique across manufacturers, so the body is identified by both
+			if (metadata.cameraModel.has_value() && !metadata.cameraModel->empty()) {
+				index.cameras[i] = getStringKey(cameraKeys, metadata.cameraMake.value_or("") + "\n" + metadata.cameraModel.value());
+			} else {
+				index.cameras[i] = -1;
+			}
+		}
+
+		buildSplits(index, parameters);
 	}
 
-	void generateGroups(std::vector<ImageGroup>& groups, GroupParameters& parameters, const std::map<int, Image>& images) {
-		generateInitialGroup(groups, images);
+	void updateGroupingParameters(GroupingIndex& index, const GroupParameters& parameters) {
+		const GroupParameters& built = index.parameters;
+		if (built.cameraEnabled != parameters.cameraEnabled || built.lensEnabled != parameters.lensEnabled ||
+			built.focalLengthEnabled != parameters.focalLengthEnabled || built.focalLengthMillimeters != parameters.focalLengthMillimeters ||
+			built.similarityEnabled != parameters.similarityEnabled || built.similarityBits != parameters.similarityBits) {
+			buildSplits(index, parameters);
+		}
+	}
 
+	int countGroups(const GroupingIndex& index, const GroupParameters& parameters) {
+		int count = 1 + index.splitWithoutTimeCount;
 		if (parameters.timeEnabled) {
-			applyTimeSplits(groups, parameters.timeSeconds, images);
-		} else {
-			generateInitialGroup(groups, images);
+			auto firstSplit = std::lower_bound(index.sortedGaps.begin(), index.sortedGaps.end(), static_cast<long long>(parameters.timeSeconds));
+			count += static_cast<int>(index.sortedGaps.end() - firstSplit);
 		}
+		return count;
+	}
 
-		updateSavedSkippedCounts(groups, images);
+	void generateInitialGroup(std::vector<ImageGroup>& groups, const std::map<int, Image>& images) {
+		const GroupParameters noSplits{
+			.timeEnabled = false,
+			.timeSeconds = 0,
+			.cameraEnabled = false,
+			.lensEnabled = false,
+			.focalLengthEnabled = false,
+			.focalLengthMillimeters = 0,
+			.similarityEnabled = false,
+			.similarityBits = 0
+		};
+		GroupingIndex index;
+		buildGroupingIndex(index, noSplits, images);
+		splitGroups(groups, index, noSplits);
 	}
 
-	void applySplits(std::vector<ImageGroup>& groups, const std::map<int, Image>& images, std::function<bool(int, int)> comparator) {
-		for (int currentGroup = 0; currentGroup < groups.size(); currentGroup++) {
-			// In the current group, find the next image that should be the last in its group.
-			for (int i = 0; i < groups[currentGroup].ids.size() - 1; i++) {
-				int currentID = groups[currentGroup].ids[i];
-				int nextID = groups[currentGroup].ids[i + 1];
-
-				if (comparator(currentID, nextID)) {
-					// Split current group into 0:i and i+1:end
-					ImageGroup newGroup{
-						.ids = {groups[currentGroup].ids.begin() + i + 1, groups[currentGroup].ids.end()},
-						.savedCount = 0,
-						.skippedCount = 0
-					};
-					groups[currentGroup].ids.erase(groups[currentGroup].ids.begin() + i + 1, groups[currentGroup].ids.end());
-					groups.insert(groups.begin() + currentGroup + 1, newGroup);
-					break;
-				}
+	void generateGroups(std::vector<ImageGroup>& groups, GroupingIndex& index, const GroupParameters& parameters) {
+		updateGroupingParameters(index, parameters);
+		splitGroups(groups, index, parameters);
+	}
+
+	void buildIndex(GroupIndex& index, const std::vector<ImageGroup>& groups, const std::map<int, Image>& images) {
+		index.locations.clear();
+		index.unskippedTrees.assign(groups.size(), {});
+		for (int group = 0; group < groups.size(); group++) {
+			const std::vector<int>& ids = groups[group].ids;
+			for (int position = 0; position < ids.size(); position++) {
+				index.locations[ids[position]] = ImageLocation{
+					.group = group,
+					.position = position
+				};
 			}
+			rebuildGroupIndex(index, groups, group, images);
 		}
 	}
 
-	void applyTimeSplits(std::vector<ImageGroup>& groups, int seconds, const std::map<int, Image>& images) {
-		applySplits(groups, images, [&images, seconds](int currentID, int nextID) {
-			if (!images.at(currentID).metadata.timestamp.has_value() || !images.at(nextID).metadata.timestamp.has_value()) {
-				return false;
+	void rebuildGroupIndex(GroupIndex& index, const std::vector<ImageGroup>& groups, int group, const std::map<int, Image>& images) {
+		const std::vector<int>& ids = groups[group].ids;
+		std::vector<int>& tree = index.unskippedTrees[group];
+		tree.assign(ids.size() + 1, 0);
+		for (int position = 0; position < ids.size(); position++) {
+			tree[position + 1] = images.at(ids[position]).skipped ? 0 : 1;
+		}
+
+		// Linear construction, each node adds its range into the parent covering it
+		for (size_t i = 1; i < tree.size(); i++) {
+			size_t parent = i + (i & (~i + 1));
+			if (parent < tree.size()) {
+				tree[parent] += tree[i];
 			}
+		}
+	}
 
-			const ImageTimestamp& currentTimestamp = images.at(currentID).metadata.timestamp.value();
-			const ImageTimestamp& nextTimestamp = images.at(nextID).metadata.timestamp.value();
-			return nextTimestamp.secondsSinceEpoch - currentTimestamp.secondsSinceEpoch >= seconds;
-		});
+	void setSkipped(GroupIndex& index, int id, bool skipped) {
+		ImageLocation location;
+		if (!findImage(index, id, location)) return;
+
+		std::vector<int>& tree = index.unskippedTrees[location.group];
+		const int current = prefixSum(tree, location.position + 1) - prefixSum(tree, location.position);
+		const int value = skipped ? 0 : 1;
+		if (current != value) {
+			addToTree(tree, location.position, value - current);
+		}
+	}
+
+	bool findImage(const GroupIndex& index, int id, ImageLocation& location) {
+		auto entry = index.locations.find(id);
+		if (entry == index.locations.end()) return false;
+		location = entry->second;
+		return true;
+	}
+
+	int findNextUnskipped(const GroupIndex& index, int group, int position) {
+		const std::vector<int>& tree = index.unskippedTrees[group];
+		return findKth(tree, prefixSum(tree, position + 1) + 1);
+	}
+
+	int findPreviousUnskipped(const GroupIndex& index, int group, int position) {
+		const std::vector<int>& tree = index.unskippedTrees[group];
+		return findKth(tree, prefixSum(tree, position));
 	}
 }
@@ -3,62 +3,27 @@
 #include <iostream>
 #include "imageView.h"
 
-ImageViewer::ImageViewer(const std::map<int, Image>& images) : images(images) {
-	// Setup quad
-	float quad[] = {
-		// First triangle
-		1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-		1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-		-1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-
-		// Second triangle
-		1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-		-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-		-1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-	};
-
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
-
-	int stride = 5;
-	int positionIndex = 0;
-	glVertexAttribPointer(positionIndex, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), 0);
-	glEnableVertexAttribArray(positionIndex);
-
-	int uvIndex = 1;
-	glVertexAttribPointer(uvIndex, 2, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void *) (sizeof(float) * 3));
-	glEnableVertexAttribArray(uvIndex);
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
-	buildShaders();
-}
+ImageViewer::ImageViewer(const std::map<int, Image>& images) : images(images) {}
 
-void ImageViewer::renderFrame(double elapsed, glm::ivec2 targetSize) {
+void ImageViewer::update(double elapsed) {
 	if (animatingZoom) {
 		updateZoom(elapsed);
 	}
+}
 
+void ImageViewer::setTarget(glm::vec2 position, glm::vec2 size) {
 	// The space available in UI to render image may have changed since last frame.
-	// If so, the aspect ratio transform needs to be updated as well as the frame
-	// buffer dimensions.
-	updateTargetSize(targetSize);
-
-	frameBuffer.bind();
-
-	glViewport(0, 0, imageTargetSize.x, imageTargetSize.y);
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT);
+	// If so, the aspect ratio transform needs to be updated.
+	imageTargetPosition = position;
+	updateTargetSize(glm::ivec2(size));
+}
 
-	glUseProgram(shaderProgram);
-	renderImage();
+glm::vec2 ImageViewer::getTargetPosition() const {
+	return imageTargetPosition;
+}
 
-	frameBuffer.unbind();
+glm::ivec2 ImageViewer::getTargetSize() const {
+	return imageTargetSize;
 }
 
 void ImageViewer::updateTargetSize(glm::ivec2 newSize) {
@@ -67,7 +32,6 @@ void ImageViewer::updateTargetSize(glm::ivec2 newSize) {
 	}
 
 	imageTargetSize = newSize;
-	frameBuffer.update(newSize.x, newSize.y);
 	updateBaseImageTransform();
 }
 
@@ -106,110 +70,91 @@ void ImageViewer::pan(glm::ivec2 offset) {
 	updatePanZoomTransform();
 }
 
-void ImageViewer::setImage(int id) {
-	imageID = id;
-	updateBaseImageTransform();
+void ImageViewer::setOverlays(bool newFocusPeaking, bool newShowClipping) {
+	focusPeaking = newFocusPeaking;
+	showClipping = newShowClipping;
 }
 
-GLuint ImageViewer::getTextureId() {
-	return frameBuffer.getTextureId();
-}
+bool ImageViewer::getImagePosition(glm::vec2 screenPosition, glm::vec2& imagePosition) const {
+	if (imageID == -1 || !baseTransformSet) {
+		return false;
+	}
 
-void ImageViewer::buildShaders() {
-	const char* vertexShaderSource = R"(
-		#version 330 core
-		layout (location = 0) in vec3 position;
-		layout (location = 1) in vec2 in_uv;
-		out vec2 uv;
-		uniform mat4 transform;
-		uniform mat4 baseScaleTransform;
-		void main() {
-			uv = in_uv;
-			gl_Position = transform * baseScaleTransform * vec4(position, 1.0);
-		}
-	)";
+	// Undo the pan, zoom and aspect ratio transforms to get the position on the quad, from -1 to 1 with y up
+	glm::vec2 local = (screenPosition - imageTargetPosition) / glm::vec2(imageTargetSize);
+	glm::vec2 screenSpacePosition(local.x * 2.0f - 1.0f, 1.0f - local.y * 2.0f);
+	float zoomFactor = getZoomFactor(currentZoom);
+	glm::vec2 quadPosition = (screenSpacePosition - panOffset) / (glm::vec2(imageBaseScale) * zoomFactor);
 
-	const char* fragmentShaderSource = R"(
-		#version 330 core
-		in vec2 uv;
-		out vec4 color;
-		uniform sampler2D imageTexture;
-		void main() {
-			color = texture2D(imageTexture, uv);
-		}
-	)";
+	imagePosition = glm::vec2(quadPosition.x + 1.0f, 1.0f - quadPosition.y) / 2.0f;
+	return imagePosition.x >= 0.0f && imagePosition.x <= 1.0f && imagePosition.y >= 0.0f && imagePosition.y <= 1.0f;
+}
 
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+void ImageViewer::setImage(int id) {
+	imageID = id;
+	baseTransformSet = false;
+	updateBaseImageTransform();
+}
 
-	GLint compilationSuccess;
-	glCompileShader(vertexShader);
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compilationSuccess);
-	if (!compilationSuccess) {
-		GLint maxLength;
-		glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
-		std::string errorLog;
-		errorLog.resize(maxLength);
-		glGetShaderInfoLog(vertexShader, maxLength, &maxLength, errorLog.data());
-		std::cout << "Failed to compile vertex shader:\n" << errorLog << std::endl;
+void ImageViewer::renderImage(const ImageProgram& program) {
+	if (imageID == -1) {
+		return;
 	}
 
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-
-	glCompileShader(fragmentShader);
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compilationSuccess);
-	if (!compilationSuccess) {
-		GLint maxLength;
-		glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
-		std::string errorLog;
-		errorLog.resize(maxLength);
-		glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, errorLog.data());
-		std::cout << "Failed to compile fragment shader:\n" << errorLog << std::endl;
+	const Image& image = images.at(imageID);
+	// Until the full resolution texture is loaded, the preview is drawn in its place. Both fill the same
+	// quad, so the zoom and pan carry over when the full texture replaces it. The largest loaded preview
+	// tier is used.
+	bool usePreview = !image.imageLoaded;
+	const Preview* preview = nullptr;
+	if (usePreview) {
+		for (const Preview& tier : image.previews) {
+			if (tier.loaded) preview = &tier;
+		}
+		if (!preview) return;
 	}
 
-	shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
-	GLint linkSuccess;
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linkSuccess);
-	if (!linkSuccess) {
-		GLint maxLength;
-		glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
-		std::string errorLog;
-		errorLog.resize(maxLength);
-		glGetShaderInfoLog(shaderProgram, maxLength, &maxLength, errorLog.data());
-		std::cout << "Failed to link shaders to program:\n" << errorLog << std::endl;
+	// Set once the file info is available, which may be after the image was selected
+	if (!baseTransformSet) {
+		updateBaseImageTransform();
 	}
 
-	// Set the texture uniform to use the correct texture unit
-	glUseProgram(shaderProgram);
-	glUniform1i(glGetUniformLocation(shaderProgram, "imageTexture"), imageTextureUnit);
+	glUniformMatrix4fv(program.transform, 1, GL_FALSE, glm::value_ptr(panZoomTransform));
+	glUniformMatrix4fv(program.baseScaleTransform, 1, GL_FALSE, glm::value_ptr(baseScaleTransform));
 
-	// Default identity matrix for the zoom/pan transform
-	glm::mat4 transform = glm::mat4(1.0f);
-	GLuint transformLocation = glGetUniformLocation(shaderProgram, "transform");
-	glUniformMatrix4fv(transformLocation, 1, GL_FALSE, glm::value_ptr(transform));
+	glActiveTexture(GL_TEXTURE0 + ImageProgram::imageTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, usePreview ? preview->textureId : image.fullTextureId);
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-}
+	glm::mat3 orientation = Orientation::getDisplayToTexture(image.orientation);
+	glUniformMatrix3fv(program.orientation, 1, GL_FALSE, glm::value_ptr(orientation));
 
-void ImageViewer::renderImage() {
-	// TODO: when image is not available, maybe render some other loading image instead of nothing?
-	if (imageID == -1 || !images.at(imageID).imageLoaded) {
-		return;
+	glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
+	if (usePreview) {
+		// Inset by half a texel so that filtering doesn't blend in the letterbox background
+		glm::vec2 previewSize = glm::vec2(preview->size);
+		glm::vec2 offset = (glm::vec2(preview->contentOffset) + 0.5f) / previewSize;
+		glm::vec2 size = (glm::vec2(preview->contentSize) - 1.0f) / previewSize;
+		uvRect = glm::vec4(offset, size);
 	}
+	glUniform4fv(program.uvRect, 1, glm::value_ptr(uvRect));
 
-	const Image& image = images.at(imageID);
+	glUniform1i(program.focusPeaking, focusPeaking);
+	glUniform1i(program.showClipping, showClipping);
 
-	glActiveTexture(GL_TEXTURE0 + imageTextureUnit);
-	glBindTexture(GL_TEXTURE_2D, image.fullTextureId);
+	bool planar = image.planar && !usePreview;
+	glUniform1i(program.planar, planar);
+	if (planar) {
+		glm::ivec2 chromaSize = (image.size + image.chromaSubsampling - 1) / image.chromaSubsampling;
+		glm::vec2 chromaScale = glm::vec2(image.size) / glm::vec2(image.chromaSubsampling * chromaSize);
+		glUniform2fv(program.chromaScale, 1, glm::value_ptr(chromaScale));
+
+		for (int i = 0; i < 2; i++) {
+			glActiveTexture(GL_TEXTURE0 + ImageProgram::chromaTextureUnits[i]);
+			glBindTexture(GL_TEXTURE_2D, image.chromaTextureIds[i]);
+		}
+	}
 
-	glBindVertexArray(vao);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glActiveTexture(GL_TEXTURE0);
 }
 
 void ImageViewer::updateBaseImageTransform() {
@@ -223,7 +168,8 @@ void ImageViewer::updateBaseImageTransform() {
 	}
 
 	float windowAspectRatio = (float) imageTargetSize.x / imageTargetSize.y;
-	float imageAspectRatio = (float) image.size.x / image.size.y;
+	glm::ivec2 displaySize = Orientation::getDisplaySize(image.size, image.orientation);
+	float imageAspectRatio = (float) displaySize.x / displaySize.y;
 
 	glm::mat4 transform = glm::mat4(1.0f);
 	if (windowAspectRatio > imageAspectRatio) {
@@ -234,23 +180,24 @@ void ImageViewer::updateBaseImageTransform() {
 		// Shrink quad vertically
 		imageBaseScale = glm::vec3(1.0f, windowAspectRatio / imageAspectRatio, 1.0f);
 		transform = glm::scale(transform, imageBaseScale);
+	} else {
+		imageBaseScale = glm::vec3(1.0f, 1.0f, 1.0f);
 	}
 
-	glUseProgram(shaderProgram);
-	GLuint transformLocation = glGetUniformLocation(shaderProgram, "baseScaleTransform");
-	glUniformMatrix4fv(transformLocation, 1, GL_FALSE, glm::value_ptr(transform));
+	baseScaleTransform = transform;
+	baseTransformSet = true;
 }
 
 void ImageViewer::updatePanZoomTransform() {
-	glUseProgram(shaderProgram);
 	glm::mat4 identity = glm::mat4(1.0f);
 	float zoomFactor = getZoomFactor(currentZoom);
 	glm::mat4 scale = glm::scale(identity, glm::vec3(zoomFactor, zoomFactor, 1.0f));
 	glm::mat4 translate = glm::translate(identity, glm::vec3(panOffset, 0.0f));
-	glm::mat4 transform = translate * scale;
+	panZoomTransform = translate * scale;
+}
 
-	GLuint transformLocation = glGetUniformLocation(shaderProgram, "transform");
-	glUniformMatrix4fv(transformLocation, 1, GL_FALSE, glm::value_ptr(transform));
+bool ImageViewer::isAnimating() const {
+	return animatingZoom;
 }
 
 void ImageViewer::resetTransform() {
@@ -261,7 +208,7 @@ void ImageViewer::resetTransform() {
 	updatePanZoomTransform();
 }
 
-float ImageViewer::getZoomFactor(float zoom) {
+float ImageViewer::getZoomFactor(float zoom) const {
 	return powf(1.25f, zoom);
 }
 
@@ -334,3 +281,248 @@ void ImageViewer::updateZoom(double elapsed) {
 	clampPanToEdges();
 	updatePanZoomTransform();
 }
+
+ImageViewRenderer::ImageViewRenderer() {
+	// Setup quad
+	float quad[] = {
+		// First triangle
+		1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+		1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		-1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+
+		// Second triangle
+		1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+		-1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+	};
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+	int stride = 5;
+	int positionIndex = 0;
+	glVertexAttribPointer(positionIndex, 3, GL_FLOAT, GL_FALSE, stride * sizeof(float), 0);
+	glEnableVertexAttribArray(positionIndex);
+
+	int uvIndex = 1;
+	glVertexAttribPointer(uvIndex, 2, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void *) (sizeof(float) * 3));
+	glEnableVertexAttribArray(uvIndex);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	buildShaders();
+}
+
+ImageViewRenderer::~ImageViewRenderer() {
+	glDeleteProgram(program.program);
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void ImageViewRenderer::draw(ImDrawList* drawList, const std::vector<ImageViewer*>& views) {
+	drawnViews = views;
+	drawList->AddCallback(&ImageViewRenderer::drawCallback, this);
+	drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void ImageViewRenderer::drawCallback(const ImDrawList* drawList, const ImDrawCmd* command) {
+	static_cast<ImageViewRenderer*>(command->UserCallbackData)->renderViews(command->ClipRect);
+}
+
+void ImageViewRenderer::renderViews(const ImVec4& clipRect) {
+	const ImDrawData* drawData = ImGui::GetDrawData();
+	const glm::vec2 displayPosition(drawData->DisplayPos.x, drawData->DisplayPos.y);
+	const glm::vec2 scale(drawData->FramebufferScale.x, drawData->FramebufferScale.y);
+	const float framebufferHeight = drawData->DisplaySize.y * scale.y;
+
+	// State shared by every pane is set once
+	glUseProgram(program.program);
+	glBindVertexArray(vao);
+	glEnable(GL_SCISSOR_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (ImageViewer* view : drawnViews) {
+		const glm::vec2 targetPosition = view->getTargetPosition();
+		const glm::vec2 targetSize = glm::vec2(view->getTargetSize());
+
+		// Each pane is clipped to its own area as well as the draw command's, so a zoomed image doesn't cover its neighbors
+		glm::vec2 clipMin = glm::max(targetPosition, glm::vec2(clipRect.x, clipRect.y));
+		glm::vec2 clipMax = glm::min(targetPosition + targetSize, glm::vec2(clipRect.z, clipRect.w));
+		if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) {
+			continue;
+		}
+		clipMin = (clipMin - displayPosition) * scale;
+		clipMax = (clipMax - displayPosition) * scale;
+
+		// GL window coordinates start at the bottom left, while ImGui's start at the top left
+		glm::vec2 viewportMin = (targetPosition - displayPosition) * scale;
+		glm::vec2 viewportSize = targetSize * scale;
+		glViewport(static_cast<int>(viewportMin.x), static_cast<int>(framebufferHeight - viewportMin.y - viewportSize.y), static_cast<int>(viewportSize.x), static_cast<int>(viewportSize.y));
+		glScissor(static_cast<int>(clipMin.x), static_cast<int>(framebufferHeight - clipMax.y), static_cast<int>(clipMax.x - clipMin.x), static_cast<int>(clipMax.y - clipMin.y));
+
+		// The scissor limits the clear to the pane
+		glClear(GL_COLOR_BUFFER_BIT);
+		view->renderImage(program);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void ImageViewRenderer::buildShaders() {
+	const char* vertexShaderSource = R"(
+		#version 330 core
+		layout (location = 0) in vec3 position;
+		layout (location = 1) in vec2 in_uv;
+		out vec2 uv;
+		uniform mat4 transform;
+		uniform mat4 baseScaleTransform;
+		// Maps display coordinates to texture coordinates for the image's EXIF orientation. Both have the
+		// origin at the top left, while the quad's coordinates start at the bottom left.
+		uniform mat3 orientation;
+		// Offset and size of the image within the texture. Previews only cover part of their texture.
+		uniform vec4 uvRect;
+		void main() {
+			uv = uvRect.xy + uvRect.zw * (orientation * vec3(in_uv.x, 1.0 - in_uv.y, 1.0)).xy;
+			gl_Position = transform * baseScaleTransform * vec4(position, 1.0);
+		}
+	)";
+
+	const char* fragmentShaderSource = R"(
+		#version 330 core
+		in vec2 uv;
+		out vec4 color;
+		uniform sampler2D imageTexture;
+		uniform sampler2D cbTexture;
+		uniform sampler2D crTexture;
+		// Planar images have the Y plane in imageTexture
+		uniform bool planar;
+		// Maps Y plane coordinates to chroma plane coordinates, accounting for chroma planes that were rounded up in size
+		uniform vec2 chromaScale;
+		// Overlays marking in focus edges, and highlights or shadows clipped in any channel
+		uniform bool focusPeaking;
+		uniform bool showClipping;
+		const float peakingThreshold = 0.35;
+		const vec3 peakingColor = vec3(0.2, 1.0, 0.2);
+		const vec3 highlightClippingColor = vec3(1.0, 0.0, 0.0);
+		const vec3 shadowClippingColor = vec3(0.0, 0.3, 1.0);
+
+		float luma(vec2 position) {
+			if (planar) {
+				return texture2D(imageTexture, position).r;
+			}
+			return dot(texture2D(imageTexture, position).rgb, vec3(0.299, 0.587, 0.114));
+		}
+
+		// Sobel gradient magnitude of the luma, with taps one screen pixel apart so that edges are measured
+		// at the displayed scale and follow the zoom.
+		float edgeMagnitude() {
+			vec2 stepX = dFdx(uv);
+			vec2 stepY = dFdy(uv);
+			float topLeft = luma(uv - stepX - stepY);
+			float top = luma(uv - stepY);
+			float topRight = luma(uv + stepX - stepY);
+			float left = luma(uv - stepX);
+			float right = luma(uv + stepX);
+			float bottomLeft = luma(uv - stepX + stepY);
+			float bottom = luma(uv + stepY);
+			float bottomRight = luma(uv + stepX + stepY);
+			float gx = (topRight + 2.0 * right + bottomRight) - (topLeft + 2.0 * left + bottomLeft);
+			float gy = (bottomLeft + 2.0 * bottom + bottomRight) - (topLeft + 2.0 * top + topRight);
+			return length(vec2(gx, gy));
+		}
+
+		void main() {
+			if (planar) {
+				float y = texture2D(imageTexture, uv).r;
+				float cb = texture2D(cbTexture, uv * chromaScale).r - 128.0 / 255.0;
+				float cr = texture2D(crTexture, uv * chromaScale).r - 128.0 / 255.0;
+				// JFIF full range YCbCr to RGB
+				color = vec4(y + 1.402 * cr, y - 0.344136 * cb - 0.714136 * cr, y + 1.772 * cb, 1.0);
+			} else {
+				color = texture2D(imageTexture, uv);
+			}
+
+			if (showClipping) {
+				vec3 clamped = clamp(color.rgb, 0.0, 1.0);
+				if (max(clamped.r, max(clamped.g, clamped.b)) >= 254.5 / 255.0) {
+					color.rgb = highlightClippingColor;
+				} else if (max(clamped.r, max(clamped.g, clamped.b)) <= 0.5 / 255.0) {
+					color.rgb = shadowClippingColor;
+				}
+			}
+			if (focusPeaking && edgeMagnitude() > peakingThreshold) {
+				color.rgb = peakingColor;
+			}
+		}
+	)";
+
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+
+	GLint compilationSuccess;
+	glCompileShader(vertexShader);
+	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compilationSuccess);
+	if (!compilationSuccess) {
+		GLint maxLength;
+		glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetShaderInfoLog(vertexShader, maxLength, &maxLength, errorLog.data());
+		std::cout << "Failed to compile vertex shader:\n" << errorLog << std::endl;
+	}
+
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
+
+	glCompileShader(fragmentShader);
+	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compilationSuccess);
+	if (!compilationSuccess) {
+		GLint maxLength;
+		glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, errorLog.data());
+		std::cout << "Failed to compile fragment shader:\n" << errorLog << std::endl;
+	}
+
+	GLuint shaderProgram = glCreateProgram();
+	glAttachShader(shaderProgram, vertexShader);
+	glAttachShader(shaderProgram, fragmentShader);
+	glLinkProgram(shaderProgram);
+	GLint linkSuccess;
+	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linkSuccess);
+	if (!linkSuccess) {
+		GLint maxLength;
+		glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
+		std::string errorLog;
+		errorLog.resize(maxLength);
+		glGetShaderInfoLog(shaderProgram, maxLength, &maxLength, errorLog.data());
+		std::cout << "Failed to link shaders to program:\n" << errorLog << std::endl;
+	}
+
+	// Set the texture uniform to use the correct texture unit
+	glUseProgram(shaderProgram);
+	glUniform1i(glGetUniformLocation(shaderProgram, "imageTexture"), ImageProgram::imageTextureUnit);
+	glUniform1i(glGetUniformLocation(shaderProgram, "cbTexture"), ImageProgram::chromaTextureUnits[0]);
+	glUniform1i(glGetUniformLocation(shaderProgram, "crTexture"), ImageProgram::chromaTextureUnits[1]);
+
+	program = ImageProgram{
+		.program = shaderProgram,
+		.transform = glGetUniformLocation(shaderProgram, "transform"),
+		.baseScaleTransform = glGetUniformLocation(shaderProgram, "baseScaleTransform"),
+		.orientation = glGetUniformLocation(shaderProgram, "orientation"),
+		.uvRect = glGetUniformLocation(shaderProgram, "uvRect"),
+		.planar = glGetUniformLocation(shaderProgram, "planar"),
+		.chromaScale = glGetUniformLocation(shaderProgram, "chromaScale"),
+		.focusPeaking = glGetUniformLocation(shaderProgram, "focusPeaking"),
+		.showClipping = glGetUniformLocation(shaderProgram, "showClipping")
+	};
+
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+}
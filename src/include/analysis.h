@@ -0,0 +1,15 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+Statistics computed from an image's pixels while its preview is written, used for culling.
+*/
+namespace Analysis {
+	/*
+	Estimates how well focused an interleaved RGB image is, as the variance of the Laplacian of its
+	luma. The image is split into a grid of tiles and the highest tile variance is returned, so a sharp
+	subject in front of a blurred background still scores high. Scores are only comparable between
+	images analyzed at similar sizes, such as the downscaled images used for previews.
+	*/
+	float sharpness(const unsigned char* source, glm::ivec2 sourceSize);
+}
@@ -35,10 +35,21 @@ private:
     ImageCache* cache;
     Monitor* monitor;
     std::vector<Group::ImageGroup> groups;
+    Group::GroupIndex groupIndex;
+    Group::GroupingIndex groupingIndex;
     Group::GroupParameters groupParameters;
     double previousFrameTime;
     bool directoryOpen = false;
 
+    // When idle, the main loop blocks until an event arrives or this many seconds pass.
+    const double idleWaitSeconds = 0.5;
+    // Frames rendered after an event before waiting again, giving ImGui time to settle hover and
+    // other state that lags input by a frame.
+    const int framesAfterEvent = 3;
+    // Limits the time step after a long wait, so animations don't jump.
+    const double maxFrameElapsed = 0.1;
+    int activeFramesRemaining = 0;
+
     // Data processing
     ProcessingState processingState = ProcessingState_None;
     std::atomic_bool directoryLoaded;
@@ -48,6 +59,11 @@ private:
     int preloadNextImageCount;
     int preloadPreviousImageCount;
 
+    /*
+    Handles window events, waiting for the next event if nothing on screen needs to change. Frames
+    continue while the cache has uploads to finish or the UI is animating.
+    */
+    void processEvents();
     void loadImageWithPreload(int id);
     void toggleSaveImage(int id);
     void toggleSkipImage(int id);
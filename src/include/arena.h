@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+
+/*
+Allocator for the large, short-lived buffers used while decoding images. Each thread keeps a
+small cache of released blocks, so decoding a sequence of similarly sized images reuses the
+same memory instead of mapping and page-faulting a fresh buffer for every image. Large blocks
+are requested with transparent huge pages where the platform supports it.
+
+Memory returned by `allocate` must be released with `release`, but may be released from any
+thread. Blocks are returned to the cache of the releasing thread.
+*/
+namespace Arena {
+	struct ArenaStats {
+		// Number of calls to `allocate`, including reallocations that required a new buffer
+		unsigned long long allocations = 0;
+		// Allocations served from a previously released block
+		unsigned long long reusedAllocations = 0;
+		// Blocks requested from the system
+		unsigned long long systemAllocations = 0;
+		// Blocks requested from the system that were backed by huge pages
+		unsigned long long hugePageAllocations = 0;
+		// Bytes currently held by blocks, both in use and cached
+		unsigned long long reservedBytes = 0;
+	};
+
+	void* allocate(size_t size);
+	void* reallocate(void* pointer, size_t size);
+	void release(void* pointer);
+
+	/*
+	Returns the blocks cached by the calling thread to the system, except for the largest one so
+	the next full size decode on the thread still reuses memory. Called by threads that have been
+	idle for a while, so they don't hold on to more than one decode buffer.
+	*/
+	void trim();
+
+	void getStats(ArenaStats& stats);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <set>
@@ -9,7 +10,11 @@
 #include <string>
 #include <vector>
 #include <glm/glm.hpp>
+#include "arena.h"
 #include "glCommon.h"
+#include "orientation.h"
+#include "similarity.h"
+#include "texturePool.h"
 
 using u64 = unsigned long long;
 
@@ -31,24 +36,64 @@ struct ImageMetadata {
 	std::optional<double> aperture = std::nullopt;
 	std::optional<unsigned short> iso = std::nullopt;
 	std::optional<double> focalLength = std::nullopt;
+	std::optional<std::string> lensModel = std::nullopt;
 	std::optional<glm::vec2> resolution = std::nullopt;
 	std::optional<ImageTimestamp> timestamp = std::nullopt;
 };
 
+/*
+Sizes of the previews generated for each image. Every resident tier is produced from the same decode,
+each reduced from the tier above it. The small tier is always resident, since it's shown in the lists
+and the contact sheet and the image's difference hash and sharpness are computed along with it.
+*/
+enum PreviewTier {
+	PreviewTier_Small = 0,
+	PreviewTier_Medium = 1,
+	PreviewTier_Large = 2,
+	PreviewTier_Count = 3
+};
+
+struct Preview {
+	unsigned int textureId = 0;
+	glm::ivec2 size{ 0, 0 };
+	// Region of the preview texture covered by the image. The rest is filled with the background color.
+	glm::ivec2 contentOffset{ 0, 0 };
+	glm::ivec2 contentSize{ 0, 0 };
+	// True if the texture is available on GPU
+	bool loaded = false;
+};
+
 struct Image {
 	int id = -1;
 	std::string filename;
 	std::string shortFilename;
 	std::string path;
 	glm::ivec2 size;
-	glm::ivec2 previewSize;
+	// Indexed by `PreviewTier`. Tiers that aren't resident are never loaded.
+	Preview previews[PreviewTier_Count];
 	ImageMetadata metadata;
 	unsigned int filesize;
 	unsigned int timestamp;
-	unsigned int previewTextureId;
 	unsigned int fullTextureId;
-	// Flags are true if the texture is available on GPU
-	bool previewLoaded = false;
+	// Planar images store their full resolution data as separate Y, Cb and Cr textures. `fullTextureId`
+	// holds the Y plane, and the chroma planes are reduced in size by `chromaSubsampling`.
+	bool planar = false;
+	glm::ivec2 chromaSubsampling{1, 1};
+	unsigned int chromaTextureIds[2];
+	// EXIF orientation. Textures are stored in the file's pixel order, with the first row at the top, and
+	// are rotated or mirrored into place when drawn.
+	int orientation = Orientation::normal;
+	// Levels of the full resolution textures' mip chains that hold valid data. Sampling is limited to
+	// these levels while the rest are generated.
+	int mipLevelsGenerated = 0;
+	// Difference hash of the preview content, for grouping visually similar images. Set along with the
+	// preview, from the same downscaled pixels.
+	unsigned long long differenceHash = 0;
+	bool hasDifferenceHash = false;
+	// Focus score from `Analysis::sharpness`, also set along with the preview. Higher is sharper.
+	float sharpness = 0.0f;
+	bool hasSharpness = false;
+	// True if the full resolution texture is available on GPU
 	bool imageLoaded = false;
 	// True if the image metadata is loaded
 	bool fileInfoLoaded = false;
@@ -58,6 +103,43 @@ struct Image {
 	bool saved = false;
 };
 
+/*
+A staging buffer shared by many preview textures. Each preview load is assigned a slot in the
+batch PBO, which the image loading threads write into. Once every slot has been written, the
+main thread uploads all previews in the batch together, using a single fence for the buffer.
+*/
+struct PreviewBatch {
+	enum State {
+		// Not in use, the PBO may be mapped for a new batch
+		State_Available,
+		// Slots are being assigned to preview loads this frame
+		State_Filling,
+		// No more slots will be assigned, waiting for the image loading threads to write every slot
+		State_Decoding,
+		// Uploaded, waiting for the GPU to finish reading from the PBO
+		State_Uploading,
+	};
+
+	unsigned int pbo;
+	unsigned char* mapping;
+	State state;
+	int directoryID;
+	// Preview tiers written to each slot, one after another from the small tier, as a mask of
+	// `1 << PreviewTier`. Set when the batch is mapped, so batches in flight keep their layout if the
+	// resident tiers change.
+	int tiers;
+	unsigned int slotBytes;
+	int slotCapacity;
+	int slotCount;
+	// Image id for each assigned slot
+	std::vector<int> imageIDs;
+	// Set by the image loading threads, true if the slot holds a valid preview
+	std::vector<char> slotLoaded;
+	// Slots assigned but not yet written by an image loading thread
+	std::atomic_int remainingSlots;
+	GLsync fence;
+};
+
 /*
 An item in the image loading queue. These entries are consumed by one of the image
 loading threads. The image represented by `imageID` is decoded from disk and copied
@@ -69,14 +151,36 @@ struct ImageQueueEntry {
 	unsigned int pbo;
 	void* pboMapping;
 	// True if the image should be loaded in the preview format instead of its full resolution and aspect ratio.
+	// Preview entries don't have their own PBO, the preview is written to `previewBatch`.
 	bool isPreview;
+	// Batch and slot receiving the preview generated from this entry, or null if the preview is not needed.
+	// Full resolution entries may also have a slot, in which case one decode produces both textures.
+	PreviewBatch* previewBatch;
+	int previewSlot;
+	// Set for the image being viewed. Its decode is split across several threads to reduce the time until it's shown.
+	bool highPriority;
 };
 
 struct TextureQueueEntry {
 	int imageID;
 	int directoryID;
 	unsigned int pbo;
-	bool isPreview;
+};
+
+/*
+Mip levels of an image's full resolution textures being copied into a PBO by the GPU, which its previews
+are created from once `fence` signals. Planar images store the Y level followed by the Cb and Cr levels,
+other images store RGB pixels.
+*/
+struct MipmapReadback {
+	int imageID;
+	unsigned int pbo;
+	GLsync fence;
+	// Preview tiers to create, as a mask of `1 << PreviewTier`
+	int tiers;
+	glm::ivec2 levelSize;
+	// Size of the chroma levels, for planar images
+	glm::ivec2 chromaLevelSize;
 };
 
 struct PBOQueueEntry {
@@ -91,7 +195,8 @@ struct LRUNode {
 };
 
 struct ImageCacheUIData {
-	glm::ivec2 previewTextureSize{};
+	glm::ivec2 previewTextureSizes[PreviewTier_Count]{};
+	int residentPreviewTiers;
 	int cacheCapacity;
 	int imageLoadingThreads;
 	int previewCount;
@@ -104,6 +209,11 @@ struct ImageCacheUIData {
 	int pendingImageQueueSize;
 	int availablePBOQueueSize;
 	int pendingPBOSize;
+	int previewBatchesInFlight;
+	int pooledTextureCount;
+	int freePooledTextureCount;
+
+	Arena::ArenaStats decodeArenaStats;
 };
 
 class ImageCache {
@@ -118,10 +228,24 @@ public:
 	void clear();
 
 	void frameUpdate();
+	/*
+	True if the main thread has work to continue on the next frame, such as queued uploads or transfers
+	waiting on a fence. Image loading threads wake the main thread with an empty event when they finish
+	an image, so decoding alone doesn't require frames.
+	*/
+	bool hasPendingWork();
+	// While paused, the image loading threads finish their current image but don't start new ones.
+	void setPaused(bool paused);
 	// Returns an image, but this image is not updated in the context of the LRU cache.
 	Image* getImage(int id);
 	
 	void updateCapacity(int capacity);
+	/*
+	Sets the preview tiers generated for each image, as a mask of `1 << PreviewTier`. The small tier is
+	always included. Applies to previews loaded after the call, so it's meant to be followed by opening
+	a directory.
+	*/
+	void setResidentPreviewTiers(int tiers);
 
 	/*
 	For each provided id, move that image to front of LRU list and add it to the image queue
@@ -129,6 +253,11 @@ public:
 	*/
 	void useImageFullTexture(int id);
 	void useImagesFullTextures(std::vector<int>& ids);
+	/*
+	Moves the full resolution load of an image ahead of all other queued loads, and marks it to be
+	decoded with several threads. Has no effect if the load has already started.
+	*/
+	void prioritizeImage(int id);
 
 	/*
 	Initializes the cache to have an entry for every valid image file in the given directory. Full resolution
@@ -137,6 +266,10 @@ public:
 	*/
 	void initCacheFromDirectory(std::string path, std::atomic_bool& directoryLoaded);
 	const std::map<int, Image>& getImages() const;
+	// Size of the preview textures of a tier, which previews are letterboxed into.
+	glm::ivec2 getPreviewTextureSize(PreviewTier tier) const;
+	// Mask of `1 << PreviewTier` for the tiers generated for each image.
+	int getResidentPreviewTiers() const;
 	/*
 	Called right after the image directory is traversed and all files and their sizes are known. Pushes entires to
 	load preview textures for every image, as well as entires to load full resolution textures for the first n
@@ -146,6 +279,12 @@ public:
 
 	bool previewLoadingComplete() const;
 	float getPreviewLoadProgress() const;
+	/*
+	Sets `matches` to the images anywhere in the directory whose difference hash is within `maxDistance`
+	bits of the given image's, closest first, excluding the image itself. Only images with a loaded
+	preview are indexed.
+	*/
+	void findSimilarImages(int id, int maxDistance, std::vector<Similarity::Match>& matches) const;
 
 	void getUIData(ImageCacheUIData& data);
 
@@ -153,16 +292,42 @@ private:
 	// Max full resolution images to keep stored in GPU at a time
 	int cacheCapacity;
 	const int defaultImageLoadThreads = 1;
+	// Only limits full resolution textures, previews are uploaded by the batch
 	const int textureQueueEntriesPerFrame = 1;
-	const glm::ivec2 previewTextureSize{75, 75};
+	const int fullImageEntriesPerFrame = 5;
+	const int maxParallelDecodeThreads = 8;
+	// Time a loading thread waits without work before returning its cached decode buffers
+	const std::chrono::seconds arenaTrimDelay{ 5 };
+	const int previewBatchCount = 4;
+	// Slots per batch, limited further by the batch size when larger tiers are resident
+	const int previewBatchCapacity = 64;
+	const unsigned int previewBatchBytes = 8 * 1024 * 1024;
+	// Full resolution textures for images that can't be decoded into planes are stored as RGBA8 and
+	// uploaded as BGRA, the layout drivers can copy without converting. Images are expanded to this
+	// layout when copied into the PBO.
+	const GLenum fullTextureFormat = GL_RGBA8;
+	const int fullTextureBytesPerPixel = 4;
+	// Each plane of a planar image is a single channel texture
+	const GLenum planeTextureFormat = GL_R8;
+	// Texels of mip levels generated per frame. At least one level is generated each frame.
+	const u64 mipmapTexelsPerFrame = 16 * 1024 * 1024;
+	// Previews read back from mip levels at a time, and created from completed read backs per frame
+	const int maxMipmapReadbacks = 4;
+	const int mipmapReadbacksPerFrame = 2;
+	const glm::ivec2 previewTextureSizes[PreviewTier_Count] = { {75, 75}, {256, 256}, {512, 512} };
+	int residentPreviewTiers = 1 << PreviewTier_Small;
 	const glm::ivec3 previewBackgroundColor{50, 50, 50};
+	// Long edge of the image that sharpness and the difference hash are computed from
+	const int analysisLongEdge = 150;
 	const int shortFilenameLength = 16;
 
 	int nextImageID = 0;
 	int currentDirectoryID = 0;
-	unsigned char* previewTextureBackground;
 	int imageLoadThreads = defaultImageLoadThreads;
+	// Threads used to decode a single high priority image
+	int parallelDecodeThreads = defaultImageLoadThreads;
 	std::atomic_bool runImageLoadThreads;
+	std::atomic_bool imageLoadingPaused;
 	std::map<int, Image> images;
 	std::deque<ImageQueueEntry> imageQueue;
 	std::deque<TextureQueueEntry> textureQueue;
@@ -180,16 +345,29 @@ private:
 	// Used to track progress of the initial loads before full resolution textures can be
 	// used normally.
 	std::set<int> previewsLoaded;
+	// Difference hashes of the loaded previews, added as each preview is uploaded.
+	Similarity::BKTree similarityIndex;
 
 	// Pending image queue: queue containing requested images on the main thread.
 	// Entries are only popped from this queue once they can be paired with an available
 	// PBO, and moved into the imageQueue accessible by the image loading threads.
 	std::deque<ImageQueueEntry> pendingImageQueue;
 	std::set<int> pendingImageQueueIds;
+	std::set<int> pendingPreviewIds;
+	// Ids of images whose preview will be produced by a full resolution entry already in the image
+	// queue, or by a mip level read back. Preview entries for these images are dropped instead of
+	// decoding the image again.
+	std::set<int> previewsInFlight;
 
 	// PBO queues
 	std::deque<PBOQueueEntry> availablePBOQueue;
 	std::map<unsigned int, GLsync> pboToFence;
+	std::vector<PreviewBatch*> previewBatches;
+	TexturePool texturePool;
+	// Ids of images with full resolution textures still generating their mip chains
+	std::deque<int> mipmapQueue;
+	std::deque<MipmapReadback> mipmapReadbacks;
+	std::vector<unsigned int> availableReadbackPBOs;
 
 	// LRU linked-list components
 	LRUNode* lruHead = nullptr;
@@ -206,27 +384,85 @@ private:
 
 	void startImageLoadingThreads();
 	/*
-	Pulls entries from the pending image queue, pairs them with an available PBO, and moves
-	the entry into the image queue.
+	Pulls entries from the pending image queue, pairs them with an available PBO or preview batch
+	slot, and moves the entry into the image queue.
 	*/
 	void processPendingImageQueue();
+	/*
+	Attaches a preview slot to a full resolution entry so that a single decode produces both textures.
+	An unstarted preview entry for the same image is taken from the image queue if one exists, otherwise
+	a pending preview entry is replaced using a slot in `batch`. Returns true if the preview was attached.
+	*/
+	bool attachPreviewToEntry(ImageQueueEntry& entry, PreviewBatch*& batch);
+	/*
+	Assigns the next slot of the batch being filled this frame to the entry, mapping a new batch if
+	needed. Returns false if no batch slots are available.
+	*/
+	bool assignPreviewSlot(ImageQueueEntry& entry, PreviewBatch*& batch);
+	void* mapPBO(unsigned int pbo, unsigned int bytes);
 	void processTextureQueue();
+	/*
+	Uploads every preview in batches whose slots have all been written, and returns batches to the
+	available state once the GPU has finished reading from them.
+	*/
+	void processPreviewBatches();
+	/*
+	Generates mip levels for recently uploaded full resolution textures, one level at a time, until the
+	texel budget for the frame is used.
+	*/
+	void processMipmapQueue();
+	// Fills `level` of the texture's mip chain from the level above it.
+	void generateMipLevel(GLuint texture, int level);
+	// Number of levels in the mip chain of an image's full resolution textures
+	int getMipLevelCount(const Image& image) const;
+	/*
+	Starts reading back the smallest mip level of an image's full resolution textures that still covers
+	the largest resident preview, so its previews can be created without decoding the file again. Returns
+	false if too many read backs are already in flight.
+	*/
+	bool startMipmapReadback(const Image& image);
+	// Creates the previews of completed read backs, up to `mipmapReadbacksPerFrame` each frame.
+	void processMipmapReadbacks();
+	void createPreviewFromReadback(Image& image, const MipmapReadback& readback, const unsigned char* data);
+	/*
+	Creates a texture for each preview tier in `tiers` from pixels in the layout written by `writePreviews`,
+	or an offset into the bound PBO.
+	*/
+	void uploadPreviewTextures(Image& image, const unsigned char* pixels, int tiers);
+	// Bytes of a preview slot holding the given tiers, and the offset of one tier within it.
+	unsigned int getPreviewSlotBytes(int tiers) const;
+	unsigned int getPreviewTierOffset(int tiers, PreviewTier tier) const;
 	void processPendingPBOQueue();
 	void threadInitCacheFromDirectory(std::string path, std::atomic_bool& directoryLoaded);
 	void runImageLoadThread(int threadID);
 	/*
-	Loads an image file for the given image id. This file is then decoded and stored in a buffer,
-	which `imageData` is updated to point to. The image is also resized to the preview size, and stored in a buffer
-	which `previewImageData` is updated to point to.
-
-	If the full resolution image does not need to be saved, pass `skipFullResolution` as true. This will only generate
-	the preview image, freeing the full resolution image after the resize is complete. `imageData` will be set to
-	a null pointer.
-
-	If the preview image does not need to be saved, pass `skipPreview` as true. This will only allocate space for the
-	full resolution. `previewData` will be set to a null pointer.
+	Loads and decodes the image file for the given image id. If `textureData` is not null, the
+	full resolution texture data is written to it in the layout described by `getFullTextureBytes`.
+	If `previewData` is not null, the decoded image is also resized into the preview tiers in
+	`previewTiers` and written to `previewData` by `writePreviews`. Planar images are decoded using
+	`decodeThreads` threads.
+	*/
+	bool loadImageFromFile(int id, unsigned char* previewData, int previewTiers, unsigned char* textureData, int decodeThreads);
+	/*
+	Size of the full resolution texture data for an image. Planar images store the Y plane followed
+	by the Cb and Cr planes, each tightly packed. Other images store BGRA pixels.
+	*/
+	unsigned int getFullTextureBytes(const Image& image) const;
+	/*
+	Resizes an RGB image into the letterboxed preview of each tier in `tiers`, written one after another
+	to `previewData` from the small tier, and sets the image's difference hash and sharpness, computed
+	at a size set by `analysisLongEdge` regardless of `sourceSize`. Only the
+	largest tier is reduced from `source`, and each smaller tier is reduced from the one above it.
+	`source` may be smaller than the image itself.
+	*/
+	void writePreviews(Image& image, const unsigned char* source, glm::ivec2 sourceSize, unsigned char* previewData, int tiers);
+	/*
+	Sets the region of each tier's preview texture that holds the image. This is the largest size matching
+	the image's aspect ratio that fits within the preview, centered.
 	*/
-	bool loadImageFromFile(int id, bool loadPreview, unsigned char*& imageData);
+	void setPreviewContentRect(Image& image) const;
+	glm::ivec2 getChromaPlaneSize(const Image& image) const;
+	void releaseFullTextures(Image& image);
 	
 	/*
 	Parses strings in format YYYY:MM:DD HH:MM:SS into a struct.
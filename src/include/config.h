@@ -12,7 +12,10 @@ namespace Config {
 		KeyAction_ToggleHideSkipped = 5,
 		KeyAction_ToggleLockMovement = 6,
 		KeyAction_ReturnToGroups = 7,
-		KeyAction_Count = 8
+		KeyAction_ToggleFocusPeaking = 8,
+		KeyAction_ToggleClipping = 9,
+		KeyAction_ShowLoupe = 10,
+		KeyAction_Count = 11
 	};
 
 	struct Config {
@@ -20,6 +23,10 @@ namespace Config {
 		unsigned int cacheCapacity = 10;
 		unsigned int cacheForwardPreload = 3;
 		unsigned int cacheBackwardPreload = 1;
+		// Bitmask of the preview sizes kept in memory: 1 for 75 px, 2 for 256 px and 4 for 512 px. The 75 px
+		// previews are always kept. Each 256 px preview takes about 200 KB of texture memory for the whole
+		// session, so larger tiers are opt-in.
+		unsigned int previewTiers = 1;
 
 		Config() {
 			keyToAction.emplace(GLFW_KEY_SPACE, KeyAction_Save);
@@ -44,6 +51,12 @@ namespace Config {
 			keyToAction.emplace(GLFW_KEY_L, KeyAction_ToggleLockMovement);
 
 			keyToAction.emplace(GLFW_KEY_ESCAPE, KeyAction_ReturnToGroups);
+
+			keyToAction.emplace(GLFW_KEY_F, KeyAction_ToggleFocusPeaking);
+
+			keyToAction.emplace(GLFW_KEY_C, KeyAction_ToggleClipping);
+
+			keyToAction.emplace(GLFW_KEY_Z, KeyAction_ShowLoupe);
 		}
 
 		void update(const Config& source) {
@@ -54,6 +67,7 @@ namespace Config {
 			cacheCapacity = source.cacheCapacity;
 			cacheForwardPreload = source.cacheForwardPreload;
 			cacheBackwardPreload = source.cacheBackwardPreload;
+			previewTiers = source.previewTiers;
 		}
 	};
 
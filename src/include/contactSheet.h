@@ -0,0 +1,140 @@
+#pragma once
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "imgui.h"
+#include "cache.h"
+#include "glCommon.h"
+
+/*
+A scrollable grid of preview thumbnails for a whole group, drawn with one instanced draw call. Previews
+are separate textures, so the tiles on screen are copied into slots of a texture array atlas on the GPU,
+and each tile is an instance reading its slot. Slots are reused for other images once their tile has
+scrolled out of view, which keeps the atlas a fixed size however many images the group has. Only the
+rows in view are laid out each frame.
+
+The atlas holds the smallest resident preview tier that covers the tile size on screen, and is created
+again with that tier's slot size when zooming moves to another tier.
+*/
+class ContactSheet {
+public:
+	ContactSheet(const ImageCache& imageCache);
+	~ContactSheet();
+
+	// Advances the scroll and zoom animations. Called once per frame.
+	void update(double elapsed);
+	/*
+	True while the scroll or zoom is animating, or while tiles in view are waiting for a slot copy, which
+	requires frames to be rendered even without input.
+	*/
+	bool isAnimating() const;
+
+	/*
+	Lays out the tiles of `ids` in the screen area at `position` and `size`, in ImGui coordinates, and
+	prepares the tiles in view for drawing. When `selectedID` changes, the grid scrolls to keep its tile
+	in view. Called every frame the sheet is shown, before `draw`.
+	*/
+	void layout(glm::vec2 position, glm::vec2 size, const std::vector<int>& ids, int selectedID, int hoveredID);
+	// Adds the draw callback for the tiles prepared by the last call to `layout`.
+	void draw(ImDrawList* drawList);
+
+	// Scrolls by a number of mouse wheel steps. Positive offsets move toward the top.
+	void scroll(int offset);
+	// Changes the tile size by a number of zoom steps, keeping the point under `position` in place.
+	void zoom(int offset, glm::vec2 position);
+	// Returns the image whose tile is at a screen position, or -1 if there is none.
+	int getImageAt(glm::vec2 position) const;
+	// Releases every atlas slot, such as when the preview textures they were copied from are deleted.
+	void clear();
+
+private:
+	struct TileInstance {
+		// Screen position and size of the tile in pixels, relative to the top left of the sheet
+		glm::vec4 rect;
+		// Offset and size of the preview content within the atlas, in normalized texture coordinates
+		glm::vec4 uvRect;
+		// Fraction of the tile covered by the content, which is centered within it
+		glm::vec2 contentScale;
+		// Atlas layer or -1 if the preview isn't copied yet, EXIF orientation, and `TileFlags`
+		glm::ivec3 state;
+	};
+
+	enum TileFlags {
+		TileFlag_Selected = 1,
+		TileFlag_Hovered = 2,
+		TileFlag_Saved = 4,
+		TileFlag_Skipped = 8,
+	};
+
+	const ImageCache& imageCache;
+	const std::map<int, Image>& images;
+
+	// Tiles are square, with a gap between them that also holds the selection border
+	const float minTileSize = 64.0f;
+	const float maxTileSize = 320.0f;
+	const float tileSpacing = 8.0f;
+	const float zoomSpeed = 1.2f;
+	const float scrollSpeed = 0.75f;
+	// Unit is %distance per second
+	const float animationLag = 12.0f;
+	float tileSize = 128.0f;
+	float targetTileSize = 128.0f;
+	float scrollOffset = 0.0f;
+	float targetScrollOffset = 0.0f;
+	glm::vec2 zoomPosition{ 0, 0 };
+
+	glm::vec2 sheetPosition{ 0, 0 };
+	glm::vec2 sheetSize{ 1, 1 };
+	int columns = 1;
+	int lastSelectedID = -1;
+	std::vector<int> shownIDs;
+
+	// The atlas is a texture array with a grid of preview sized slots on each layer. It is created when
+	// the sheet is first laid out. Larger tiers have fewer slots per layer, so more layers are added to
+	// keep at least `minAtlasSlots`, enough for a screen of the largest tiles.
+	const int atlasLayerSize = 1024;
+	const int minAtlasLayerCount = 16;
+	const int minAtlasSlots = 128;
+	// Slot copies per frame, which spreads the work of filling the atlas after a large jump
+	const int maxCopiesPerFrame = 256;
+	GLuint atlasTexture = 0;
+	PreviewTier atlasTier = PreviewTier_Small;
+	glm::ivec2 slotSize{ 0, 0 };
+	glm::ivec2 slotsPerLayer{ 0, 0 };
+	std::unordered_map<int, int> imageSlots;
+	// Image held by each slot, or -1, and the frame it was last in view
+	std::vector<int> slotImages;
+	std::vector<unsigned long long> slotLastUsed;
+	std::vector<int> freeSlots;
+	unsigned long long frame = 0;
+	// Images whose previews are copied into their slots in the next draw callback
+	std::vector<std::pair<int, int>> pendingCopies;
+	// Tiles in view with a loaded preview that didn't get a slot in the last layout
+	int copyBacklog = 0;
+
+	std::vector<TileInstance> instances;
+	static constexpr GLuint atlasTextureUnit = 1;
+	GLuint program = 0;
+	GLint viewSizeLocation;
+	GLuint vao = 0;
+	GLuint quadVBO = 0;
+	GLuint instanceVBO = 0;
+	GLuint copyFramebuffer = 0;
+
+	// Creates the atlas for a tier's previews, replacing the current atlas and releasing its slots.
+	void createAtlas(PreviewTier tier);
+	// The smallest resident tier at least as large as the tiles on screen, or the largest resident tier.
+	PreviewTier getTileTier() const;
+	void buildShaders();
+	// Finds the slot for an image's preview, assigning one if the preview needs to be copied. Returns -1 if
+	// no slot is available this frame.
+	int acquireSlot(const Image& image);
+	void clampScroll();
+	int getColumnCount(float size) const;
+	// Horizontal offset of the first column, which centers the columns in the sheet
+	float getColumnsOffset(float size, int columnCount) const;
+
+	static void drawCallback(const ImDrawList* drawList, const ImDrawCmd* command);
+	void renderTiles(const ImVec4& clipRect);
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include <limits>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include "cache.h"
 
@@ -12,14 +14,112 @@ namespace Group {
 
 	enum GroupParam {
 		GroupParam_Time = 0,
+		GroupParam_Camera = 1,
+		GroupParam_Lens = 2,
+		GroupParam_FocalLength = 3,
+		GroupParam_Similarity = 4,
 	};
 
+	enum GroupSort {
+		GroupSort_Filename = 0,
+		// Sharpest first, for comparing the best candidates of a burst first
+		GroupSort_Sharpness = 1,
+	};
+
+	/*
+	Criteria for splitting the filename ordered images into groups. A new group starts between two
+	consecutive images if any enabled criterion is met. Images missing the metadata for a criterion
+	never split on it.
+	*/
 	struct GroupParameters {
 		// Min number of seconds between images to be considered different groups
 		bool timeEnabled = false;
 		int timeSeconds = 10;
+		// Split when the camera body changes
+		bool cameraEnabled = false;
+		// Split when the lens changes
+		bool lensEnabled = false;
+		// Min change in focal length, in millimeters, to be considered different groups
+		bool focalLengthEnabled = false;
+		int focalLengthMillimeters = 10;
+		// Min number of differing bits between the difference hashes of images to be considered different groups
+		bool similarityEnabled = false;
+		int similarityBits = 12;
+	};
+
+	/*
+	The metadata used for grouping, copied out of the image map into one array per field and ordered by
+	filename. Strings are replaced by small integer keys, and missing values are stored as -1.
+
+	The split points that don't depend on time are precomputed for the parameters the index was built
+	with. The time gaps between the remaining consecutive images are kept sorted, like the merge heights
+	of a single-linkage clustering on time, so the number of groups for any time threshold is a binary
+	search and the groups themselves are one pass over the arrays. Must be rebuilt when the images or
+	their metadata change.
+	*/
+	struct GroupingIndex {
+		static constexpr long long noGap = std::numeric_limits<long long>::min();
+
+		std::vector<const Image*> images;
+		std::vector<int> ids;
+		std::vector<long long> timestamps;
+		std::vector<bool> hasTimestamp;
+		std::vector<int> cameras;
+		std::vector<int> lenses;
+		std::vector<float> focalLengths;
+		std::vector<unsigned long long> hashes;
+		std::vector<bool> hasHash;
+
+		// Per pair of consecutive images, whether a criterion other than time splits them.
+		std::vector<bool> splitWithoutTime;
+		int splitWithoutTimeCount = 0;
+		// Per pair of consecutive images, the seconds between them, or `noGap` if they are already split
+		// or missing a timestamp.
+		std::vector<long long> gaps;
+		std::vector<long long> sortedGaps;
+		GroupParameters parameters;
 	};
 
+	struct ImageLocation {
+		int group;
+		int position;
+	};
+
+	/*
+	Locates images within the groups and finds the nearest unskipped images in a group without scanning it.
+	Each group has a Fenwick tree over its positions counting the images that aren't skipped, so lookups and
+	updates take O(log n) in the size of the group. Must be rebuilt whenever the groups are generated.
+	*/
+	struct GroupIndex {
+		std::unordered_map<int, ImageLocation> locations;
+		// One tree per group. Index 0 is unused, index i covers a range of positions ending at position i - 1.
+		std::vector<std::vector<int>> unskippedTrees;
+	};
+
+	// Places all images in a single group ordered by filename.
 	void generateInitialGroup(std::vector<ImageGroup>& groups, const std::map<int, Image>& images);
-	void generateGroups(std::vector<ImageGroup>& groups, GroupParameters& parameters, const std::map<int, Image>& images);
+	// Splits the filename ordered images into groups in a single pass.
+	void generateGroups(std::vector<ImageGroup>& groups, GroupingIndex& index, const GroupParameters& parameters);
+
+	// Reorders the images within a group. The group index must be rebuilt afterwards.
+	void sortGroup(ImageGroup& group, GroupSort sort, const std::map<int, Image>& images);
+
+	void buildGroupingIndex(GroupingIndex& index, const GroupParameters& parameters, const std::map<int, Image>& images);
+	// Recomputes the split points if any criterion other than time changed since the index was built.
+	void updateGroupingParameters(GroupingIndex& index, const GroupParameters& parameters);
+	// Number of groups that `generateGroups` would produce, in O(log n). The index must be up to date
+	// with the parameters other than time.
+	int countGroups(const GroupingIndex& index, const GroupParameters& parameters);
+
+	void buildIndex(GroupIndex& index, const std::vector<ImageGroup>& groups, const std::map<int, Image>& images);
+	// Rebuilds the tree of one group, after the skipped state of many of its images changed.
+	void rebuildGroupIndex(GroupIndex& index, const std::vector<ImageGroup>& groups, int group, const std::map<int, Image>& images);
+	// Updates the index after the skipped state of a single image changed.
+	void setSkipped(GroupIndex& index, int id, bool skipped);
+	// Returns false if the image isn't in any group.
+	bool findImage(const GroupIndex& index, int id, ImageLocation& location);
+	// Position of the first unskipped image after `position` within the group, or -1 if there is none.
+	int findNextUnskipped(const GroupIndex& index, int group, int position);
+	// Position of the last unskipped image before `position` within the group, or -1 if there is none.
+	int findPreviousUnskipped(const GroupIndex& index, int group, int position);
 }
@@ -1,26 +1,75 @@
 #pragma once
+#include <vector>
 #include <glm/glm.hpp>
+#include "imgui.h"
 #include "cache.h"
-#include "frame_buffer.h"
 #include "glCommon.h"
 
+/*
+The shader program shared by every image view, with its uniform locations looked up once when it is
+built, and the texture units its samplers read from.
+*/
+struct ImageProgram {
+	static constexpr GLuint imageTextureUnit = 1;
+	static constexpr GLuint chromaTextureUnits[2] = { 2, 3 };
+
+	GLuint program;
+	GLint transform;
+	GLint baseScaleTransform;
+	GLint orientation;
+	GLint uvRect;
+	GLint planar;
+	GLint chromaScale;
+	GLint focusPeaking;
+	GLint showClipping;
+};
+
+/*
+The pan, zoom and selected image of one pane of the image view. Panes don't own any GL objects, they
+are drawn by an `ImageViewRenderer`.
+*/
 class ImageViewer {
 public:
 	ImageViewer(const std::map<int, Image>&);
-	void renderFrame(double elapsed, glm::ivec2 targetSize);
+	// Advances the zoom animation. Called once per frame.
+	void update(double elapsed);
+	// Sets the screen area the image is drawn into, in ImGui coordinates. Called every frame before drawing.
+	void setTarget(glm::vec2 position, glm::vec2 size);
+	glm::vec2 getTargetPosition() const;
+	glm::ivec2 getTargetSize() const;
 	void updateTargetSize(glm::ivec2 newSize);
 	void zoom(int amount, glm::ivec2 position);
 	void pan(glm::ivec2 offset);
 	void setImage(int id);
-	GLuint getTextureId();
 	void resetTransform();
+	/*
+	Enables overlays drawn by the fragment shader over the displayed image: focus peaking highlights
+	strong edges at the current zoom, and clipping marks pixels with a channel at full white or all
+	channels at black.
+	*/
+	void setOverlays(bool focusPeaking, bool showClipping);
+	/*
+	Finds the point of the image drawn at a screen position, in normalized display coordinates with the
+	origin at the top left. Returns false if the image doesn't cover that position.
+	*/
+	bool getImagePosition(glm::vec2 screenPosition, glm::vec2& imagePosition) const;
+	// True while the zoom is animating, which requires frames to be rendered even without input.
+	bool isAnimating() const;
+	/*
+	Draws the image with the shared program, which must be in use with the quad bound and the viewport
+	covering the target area.
+	*/
+	void renderImage(const ImageProgram& program);
 
 private:
 	const std::map<int, Image>& images;
 	glm::ivec2 imageTargetSize{ 1, 1 };
+	// Screen position of the area the image is drawn into, in ImGui coordinates
+	glm::vec2 imageTargetPosition{ 0, 0 };
 	glm::ivec2 imageSize;
-	glm::vec3 imageBaseScale;
-	FrameBuffer frameBuffer;
+	glm::vec3 imageBaseScale{ 1.0f, 1.0f, 1.0f };
+	// False until the aspect ratio transform has been set for the current image, which requires its file info
+	bool baseTransformSet = false;
 
 	const float zoomSpeed = 0.75f;
 	// Unit is %distance per second
@@ -31,17 +80,17 @@ private:
 	glm::vec2 targetZoomPosition;
 	glm::vec2 panOffset = glm::vec2(0, 0);
 
-	GLuint shaderProgram;
-	GLuint imageTextureUnit = 1;
+	bool focusPeaking = false;
+	bool showClipping = false;
+
 	int imageID = -1;
-	GLuint vao;
-	GLuint vbo;
+	// Uniform values, kept here since the program is shared with the other panes
+	glm::mat4 panZoomTransform{ 1.0f };
+	glm::mat4 baseScaleTransform{ 1.0f };
 
-	void buildShaders();
-	void renderImage();
 	void updateBaseImageTransform();
 	void updatePanZoomTransform();
-	float getZoomFactor(float zoom);
+	float getZoomFactor(float zoom) const;
 	/*
 	Modifies the pan offset so that backgrouund space is never shown unless required by
 	the image's aspect ratio.
@@ -52,4 +101,35 @@ private:
 	The pan offset is also updated to align with the updated zoom.
 	*/
 	void updateZoom(double elapsed);
-};
\ No newline at end of file
+};
+
+/*
+Draws every pane of the image view in a single pass over the default frame buffer. One draw list
+callback binds the shared program and quad once, then draws each pane into its own viewport, so adding
+panes costs a draw call each rather than a full render pass.
+*/
+class ImageViewRenderer {
+public:
+	ImageViewRenderer();
+	~ImageViewRenderer();
+	/*
+	Adds the panes to an ImGui draw list, each covering the area set by its last `setTarget`. The panes
+	are drawn by a draw list callback while ImGui renders.
+	*/
+	void draw(ImDrawList* drawList, const std::vector<ImageViewer*>& views);
+
+private:
+	ImageProgram program;
+	GLuint vao;
+	GLuint vbo;
+	// Panes drawn by the pending callback
+	std::vector<ImageViewer*> drawnViews;
+
+	void buildShaders();
+	static void drawCallback(const ImDrawList* drawList, const ImDrawCmd* command);
+	/*
+	Draws each pane into its target area, limited to the clip rectangle of the draw command. Called from
+	within ImGui's rendering, which restores its own state afterwards.
+	*/
+	void renderViews(const ImVec4& clipRect);
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <glm/glm.hpp>
+
+namespace Jpeg {
+	struct JpegInfo {
+		glm::ivec2 size;
+		int components;
+		// True if the image is stored as Y, Cb and Cr components that can be decoded into planes.
+		bool planar;
+		// Reduction of the Cb and Cr planes relative to the Y plane, e.g. (2, 2) for 4:2:0. Only
+		// valid for planar images.
+		glm::ivec2 chromaSubsampling;
+	};
+
+	struct Plane {
+		const unsigned char* data;
+		glm::ivec2 size;
+		// Bytes between the start of consecutive rows
+		int stride;
+	};
+
+	/*
+	The Y, Cb and Cr planes of a decoded image, before any upsampling or color conversion. Rows
+	are ordered from the top of the image. Plane memory is owned by the decoder and released
+	with `freePlanarImage`.
+	*/
+	struct PlanarImage {
+		glm::ivec2 size;
+		glm::ivec2 chromaSubsampling;
+		Plane planes[3];
+		void* decoder;
+	};
+
+	/*
+	Reads the frame header of a JPEG file to get its size and component layout, without decoding
+	any image data.
+	*/
+	bool readInfo(const std::string& path, JpegInfo& info);
+	/*
+	Decodes a JPEG file into its Y, Cb and Cr planes. Fails if the file can't be decoded or is
+	not a planar image. With a `threadCount` above one, the decode of this single image is split
+	across that many threads, which reduces the latency of loading one large image.
+	*/
+	bool decodePlanar(const std::string& path, PlanarImage& image, int threadCount = 1);
+	void freePlanarImage(PlanarImage& image);
+	/*
+	Decodes a rectangle of a JPEG image into interleaved RGB, interpolating chroma the same way the image
+	view does for a full decode. `offset` and `size` are in the stored pixel order and must lie within the
+	image. `destination` must hold size.x * size.y * 3 bytes.
+
+	For planar images with a single interleaved baseline scan, only the MCUs covering the region are
+	transformed and decoding stops after its last MCU row. Restart markers let the decode skip the data
+	between the region's rows. Other images, such as progressive, grayscale or RGB ones, are decoded in
+	full and cropped.
+	*/
+	bool decodeRegion(const std::string& path, glm::ivec2 offset, glm::ivec2 size, unsigned char* destination);
+	/*
+	Converts a planar image to interleaved RGB at the resolution of its chroma planes, averaging
+	the Y samples covered by each chroma sample. `destination` must hold the chroma plane width *
+	height * 3 bytes.
+	*/
+	void convertToRGBAtChromaResolution(const PlanarImage& image, unsigned char* destination);
+	/*
+	Converts Y, Cb and Cr planes to interleaved RGB at the resolution of the Y plane, using the nearest
+	chroma sample for each pixel. The planes may be any size, such as reduced levels of the plane textures.
+	`destination` must hold the Y plane width * height * 3 bytes.
+	*/
+	void convertPlanesToRGB(const Plane& y, const Plane& cb, const Plane& cr, unsigned char* destination);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "cache.h"
+#include "glCommon.h"
+#include "texturePool.h"
+
+/*
+Crops of the same region from a set of images, for comparing detail across a burst at 1:1. Each crop
+is decoded on a background thread with `Jpeg::decodeRegion`, which transforms only the part of the file
+covering the region, and is uploaded as a small texture instead of loading the full image. Moving the
+region or changing the images drops the requests still waiting to be decoded.
+*/
+class Loupe {
+public:
+	Loupe(int threadCount);
+	~Loupe();
+
+	/*
+	Requests a crop of `cropSize` pixels from each image, centered on a point given in normalized display
+	coordinates. The region is clamped to the edges of each image. Crops already holding their region are
+	kept, so this may be called every frame.
+	*/
+	void setRegion(const std::vector<const Image*>& images, glm::vec2 center);
+	// Removes all crops and pending requests.
+	void clear();
+	// Uploads decoded crops. Called once per frame on the main thread.
+	void frameUpdate();
+
+	// Texture holding the crop of an image in its stored orientation, or 0 if it isn't decoded yet.
+	GLuint getTexture(int id) const;
+	// True if the crop of an image could not be decoded.
+	bool failed(int id) const;
+	// Number of requested crops not yet uploaded.
+	int getPendingCount() const;
+
+	// Side length of the crops, in image pixels
+	static constexpr int cropSize = 192;
+
+private:
+	struct Region {
+		glm::ivec2 offset{ 0, 0 };
+		glm::ivec2 size{ 0, 0 };
+		bool operator==(const Region&) const = default;
+	};
+
+	struct Crop {
+		GLuint texture = 0;
+		// Region held by the texture, and the region most recently requested. Results for any other
+		// region are discarded.
+		Region uploaded;
+		Region requested;
+		bool failed = false;
+	};
+
+	struct CropRequest {
+		int imageID;
+		std::string path;
+		Region region;
+	};
+
+	struct CropResult {
+		int imageID;
+		Region region;
+		// Interleaved RGB, empty if the decode failed
+		std::vector<unsigned char> pixels;
+	};
+
+	std::unordered_map<int, Crop> crops;
+	std::vector<int> imageIDs;
+	static constexpr int maxFreeTextures = 8;
+	TexturePool texturePool;
+
+	std::vector<std::thread> threads;
+	bool runThreads = true;
+	std::mutex requestMutex;
+	std::condition_variable requestConditionVariable;
+	std::deque<CropRequest> requests;
+	std::mutex resultMutex;
+	std::vector<CropResult> results;
+
+	void runDecodeThread();
+	void releaseCrop(Crop& crop);
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+Helpers for EXIF orientations, which describe how an image's stored pixels should be mirrored and
+rotated to appear upright. Textures are uploaded in their stored order, with the first row at the
+top, and oriented only when drawn by mapping display coordinates to texture coordinates.
+*/
+namespace Orientation {
+	const int normal = 1;
+
+	/*
+	Returns the transform from normalized display coordinates to normalized texture coordinates for
+	an EXIF orientation value. Both spaces have (0, 0) at the top left. Unknown values are treated as
+	`normal`.
+	*/
+	glm::mat3 getDisplayToTexture(int orientation);
+	glm::vec2 displayToTexture(int orientation, glm::vec2 position);
+	// True for orientations that rotate the image by 90 degrees, swapping its width and height.
+	bool swapsAxes(int orientation);
+	// Size of the image once oriented for display.
+	glm::ivec2 getDisplaySize(glm::ivec2 size, int orientation);
+}
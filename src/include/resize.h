@@ -0,0 +1,43 @@
+#pragma once
+#include <functional>
+#include <glm/glm.hpp>
+
+namespace Resize {
+	// Receives an interleaved RGB image and its size.
+	using AnalyzeFunction = std::function<void(const unsigned char*, glm::ivec2)>;
+
+	/*
+	Downscales an interleaved RGB image and writes it into a letterboxed destination in a single
+	pass. Every pixel of `destination` is written exactly once: pixels within the rectangle at
+	`contentOffset` of size `contentSize` receive the resized image, and all others receive the
+	`background` color. The destination is written sequentially, so it may be write-combined
+	memory such as a mapped PBO.
+
+	Large reductions are first box filtered by an integer factor in gamma space, leaving an image
+	at least twice the content size. The remaining reduction is an area filter in linear light.
+
+	If `analyze` is given, it is called with the box filtered image, or with the source when no box
+	filtering is needed. That image is in cached memory and much smaller than the source, so statistics
+	of the image can be computed from it rather than by reading back `destination`.
+	*/
+	void resizeLetterboxRGB(
+		const unsigned char* source, glm::ivec2 sourceSize,
+		unsigned char* destination, glm::ivec2 destinationSize,
+		glm::ivec2 contentOffset, glm::ivec2 contentSize,
+		glm::ivec3 background, const AnalyzeFunction& analyze = nullptr);
+	/*
+	Copies an interleaved RGB image into the rectangle at `contentOffset` of a letterboxed destination,
+	filling the rest with the `background` color. Like `resizeLetterboxRGB`, every pixel of `destination`
+	is written once and in order.
+	*/
+	void letterboxRGB(
+		const unsigned char* source, glm::ivec2 sourceSize,
+		unsigned char* destination, glm::ivec2 destinationSize,
+		glm::ivec2 contentOffset, glm::ivec3 background);
+	/*
+	Computes a 64-bit difference hash of an interleaved RGB image. The luma is averaged over a 9x8
+	grid, and each bit records whether a cell is brighter than the cell to its right. Similar images
+	have hashes that differ in few bits. Images smaller than the grid hash to zero.
+	*/
+	unsigned long long differenceHash(const unsigned char* source, glm::ivec2 sourceSize);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <unordered_set>
+#include <vector>
+
+/*
+Index of the images' difference hashes, for finding visually similar images anywhere in a directory
+rather than only among neighbors. Hashes are stored in a BK-tree over their Hamming distance. Each
+child is tagged with its distance to the parent, so by the triangle inequality a search within d bits
+of a query only descends into children whose tag is within d of the query's distance to the parent.
+Near duplicate searches visit a small fraction of the tree.
+*/
+namespace Similarity {
+	struct Node {
+		unsigned long long hash;
+		int id;
+		// Hamming distance to the parent's hash
+		int distance;
+		// Children are a linked list through `nextSibling`, -1 terminated
+		int firstChild;
+		int nextSibling;
+	};
+
+	struct BKTree {
+		std::vector<Node> nodes;
+		std::unordered_set<int> ids;
+	};
+
+	struct Match {
+		int id;
+		int distance;
+	};
+
+	// Adds an image to the tree. Images already in the tree are ignored.
+	void insert(BKTree& tree, int id, unsigned long long hash);
+	// Sets `matches` to every image within `maxDistance` bits of `hash`, closest first.
+	void findWithin(const BKTree& tree, unsigned long long hash, int maxDistance, std::vector<Match>& matches);
+	void clear(BKTree& tree);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "glCommon.h"
+
+/*
+Owns 2D textures with fixed storage, keyed by size and internal format. Released textures are kept
+and handed out again for the next image of the same size, so switching between images refills an
+existing texture instead of allocating a new one. When immutable storage is available (GL 4.2 or
+ARB_texture_storage), textures are created with glTexStorage2D.
+*/
+class TexturePool {
+public:
+	TexturePool(int maxFreeTextures);
+	~TexturePool();
+	/*
+	Returns a texture with storage for the given size and format, including a full mip chain. The
+	contents of every level are undefined. Level 0 should be filled with glTexSubImage2D, with
+	GL_TEXTURE_MAX_LEVEL limiting sampling to the levels that have been filled.
+	*/
+	GLuint acquire(glm::ivec2 size, GLenum internalFormat);
+	// Returns a texture to the pool. The texture is deleted if the pool already has enough free textures.
+	void release(GLuint texture);
+	void setMaxFreeTextures(int count);
+	int getFreeTextureCount() const;
+	int getTotalTextureCount() const;
+	// Number of levels in a full mip chain, down to 1x1
+	static int getLevelCount(glm::ivec2 size);
+	static glm::ivec2 getLevelSize(glm::ivec2 size, int level);
+
+private:
+	struct TextureKey {
+		int width;
+		int height;
+		GLenum internalFormat;
+		auto operator<=>(const TextureKey&) const = default;
+	};
+
+	int maxFreeTextures;
+	int freeTextureCount = 0;
+	bool immutableStorage;
+	std::map<TextureKey, std::vector<GLuint>> freeTextures;
+	// Key of every texture created by the pool, whether free or in use.
+	std::map<GLuint, TextureKey> textureKeys;
+
+	GLuint createTexture(const TextureKey& key);
+	void deleteTexture(GLuint texture);
+	// Deletes free textures until the free count is within the limit.
+	void trim();
+};
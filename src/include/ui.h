@@ -2,12 +2,15 @@
 #include <array>
 #include <filesystem>
 #include <functional>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include "cache.h"
 #include "config.h"
+#include "contactSheet.h"
 #include "glCommon.h"
 #include "group.h"
 #include "imageView.h"
+#include "loupe.h"
 #include "stats.h"
 
 enum ControlPanelState {
@@ -22,13 +25,20 @@ enum ControlPanelState {
 enum ViewMode {
     ViewMode_Single = 0,
     ViewMode_Double = 1,
+    ViewMode_Grid2x2 = 2,
+    ViewMode_Grid3x3 = 3,
+    // Thumbnails of the whole group, with the selected image in the first image view
+    ViewMode_ContactSheet = 4,
+    ViewMode_Count = 5,
 };
 
 class UI {
 public:
-    UI(GLFWwindow* window, const Config::Config& config, const std::vector<Group::ImageGroup>& groups, ImageCache* imageCache, Group::GroupParameters& groupParameters, Monitor* monitor);
+    UI(GLFWwindow* window, const Config::Config& config, const std::vector<Group::ImageGroup>& groups, const Group::GroupIndex& groupIndex, const Group::GroupingIndex& groupingIndex, ImageCache* imageCache, Group::GroupParameters& groupParameters, Monitor* monitor);
     ~UI();
     void renderFrame(double elapsed);
+    // True if the UI is changing on its own and needs frames to be rendered without input.
+    bool isAnimating() const;
     int getCurrentGroupIndex() const;
     void setControlPanelState(ControlPanelState newState);
     void reset();
@@ -55,18 +65,25 @@ public:
     std::function<void(int)> onGroupSelected;
     std::function<void(int)> onImageSelected;
     std::function<void()> onRegenerateGroups;
+    // Regroups with the current parameters without reading the image metadata again, while a control is changed.
+    std::function<void()> onGroupParametersChanged;
     std::function<void(int)> onSkipImage;
     std::function<void(int)> onSaveImage;
     std::function<void(int)> onSkipGroup;
     std::function<void(int)> onSaveGroup;
     std::function<void(int)> onResetGroup;
+    std::function<void(int, Group::GroupSort)> onSortGroup;
     std::function<void(Config::Config&)> onConfigUpdate;
 
 private:
-    const glm::vec2 previewImageSize{75, 75};
+    // Size of the small preview tier, which the groups and files lists show
+    const glm::vec2 previewImageSize;
     const float controlPadding = 8.0f;
+    // Rows in the groups and files lists have a fixed height, fitting the preview within the padding
+    const float listChildHeight = previewImageSize.y + controlPadding * 2;
     const float tooltipPadding = 4.0f;
-    const float controlWidth[3] = { 250.0f, 325.0f, 325.0f };
+    // Indexed by view mode
+    const float controlWidth[ViewMode_Count] = { 250.0f, 325.0f, 325.0f, 325.0f, 250.0f };
     const glm::vec2 compareButtonSize{ 30.0f, 30.0f };
     const glm::vec2 exportButtonSize{100, 25};
     const float compareButtonSpacing = 5;
@@ -76,18 +93,33 @@ private:
     const glm::vec2 statsWindowSize{400.0f, 300.0f};
     const glm::vec2 settingsWindowSize{ 600.0f, 300.0f };
     const glm::vec2 aboutWindowSize{ 300.0f, 100.0f };
+    const glm::vec2 similarImagesWindowSize{ 350.0f, 400.0f };
+    // Difference hashes within this many bits are shown as similar images
+    const int similarImagesMaxDistance = 10;
     const float doubleClickSeconds = 0.25f;
+    const int maxGroupTimeSeconds = 60;
+    const int loupeDecodeThreads = 4;
+    // Crops requested on each side of the visible part of the loupe strip
+    const int loupeStripMargin = 2;
 
     const std::vector<Group::ImageGroup>& groups;
+    const Group::GroupIndex& groupIndex;
+    const Group::GroupingIndex& groupingIndex;
     const Config::Config& config;
 
+    // Enough image views for the largest grid
+    static constexpr int maxImageViews = 9;
+
     GLFWwindow* window;
-    ImageViewer* imageViewer[2];
+    ImageViewRenderer* imageViewRenderer;
+    std::array<ImageViewer*, maxImageViews> imageViewer;
+    Loupe* loupe;
+    ContactSheet* contactSheet;
     Group::GroupParameters& groupParameters;
     ImageCache* imageCache;
     Monitor* monitor;
     glm::ivec2 imageTargetSize;
-    std::array<glm::ivec2, 2> imageTargetPositions;
+    std::array<glm::ivec2, maxImageViews> imageTargetPositions;
     bool allowGroupInteraction = false;
     bool allowExports = false;
     bool showPreviewProgress = false;
@@ -96,35 +128,92 @@ private:
     bool settingsWindowFirstOpen = false;
     float previewProgress = 0.0f;
     bool showAboutWindow = false;
+    bool showSimilarImagesWindow = false;
+    // Results of the last "Find similar images" action
+    int similarImagesSourceID = -1;
+    std::vector<Similarity::Match> similarImages;
 
     ControlPanelState controlPanelState = ControlPanel_NothingLoaded;
     ControlPanelState prevControlPanelState = ControlPanel_NothingLoaded;
     int selectedGroup;
-    // IDs of the images, index 0 for the left and single image, and index 1 for the right image.
-    std::array<int, 2> selectedImages = {-1, -1};
+    // IDs of the images in each image view, in the order the panes are filled: index 0 is the single
+    // image or the top left pane, followed by the rest of its row. Views that aren't shown are -1.
+    std::array<int, maxImageViews> selectedImages = {-1, -1, -1, -1, -1, -1, -1, -1, -1};
     std::filesystem::path directoryPath;
 
+    /*
+    Rows of the files list: the ids of the selected group, without skipped images when those are hidden.
+    Rebuilt when the group or the hide option changes, and otherwise updated only for the images whose
+    skipped state changed.
+    */
+    struct FileFilter {
+        int group = -1;
+        bool hideSkipped = false;
+        std::vector<int> ids;
+        std::vector<int> changedIDs;
+        // Image with the highest sharpness in the group, suggested as the best of a burst
+        int sharpestID = -1;
+    };
+    FileFilter fileFilter;
+
+    // Formatted text shown in the files list, created the first time an image's row is visible.
+    struct FileLabels {
+        std::string details;
+        std::string date;
+        // False if the labels were created before the image's file info was loaded
+        bool complete;
+    };
+    std::unordered_map<int, FileLabels> fileLabels;
+
     void renderControlPanelGroupOptions();
+    // Starts a row of the group parameters table with a checkbox and a hint tooltip in the first column.
+    bool renderGroupParameterLabel(const char* label, bool* enabled, const char* tooltip);
+    void renderGroupCountCurve();
     void renderControlPanelGroupsList();
     void renderControlPanelFiles();
     void renderControlPanelSaveFilenames();
     void renderControlPanelSaveImages();
     void renderSingleImageView();
     void renderCompareImageView();
+    // Shows every image of the files list as a grid of tiles, in place of the image views.
+    void renderContactSheet();
     void renderImageViewOverlay(int imageView, glm::vec2 position);
+    // Shows the loupe region of every image in the files list along the bottom of the image view.
+    void renderLoupeStrip(glm::vec2 position, float width);
     void renderPreviewProgress();
     void renderStatsWindow();
     void renderSettingsWindow();
     void renderAboutWindow();
+    void renderSimilarImagesWindow();
 
     void selectImage(int imageView, int id);
+    // Opens the files list of the group containing an image and selects it.
+    void goToImage(int id);
+    // Toggles the skipped state of an image and updates the files list to match.
+    void toggleSkipImage(int id);
+    // Forces the files list to be rebuilt, for changes that affect many images.
+    void invalidateFileFilter();
+    void updateFileFilter();
+    const FileLabels& getFileLabels(const Image& image);
+    float listRowHeight() const;
     bool mouseOverlappingImage(int imageView);
+    // Number of image views shown in the current view mode.
+    int getImageViewCount() const;
+    // The shown image view under the cursor, or -1 if there is none. Always -1 while the contact sheet is shown.
+    int getHoveredImageView();
+    // True if any shown image view has the image selected.
+    bool isImageShown(int id) const;
+    // Resets the zoom and pan of an image view, and of every other shown view when their movement is locked.
+    void resetImageViews(int imageView);
 
     // For all relevant image views, update the selected image to the next unskipped image that is not
     // also used by another image view. If there are no more unskipped images, the selected image is
     // set to -1.
     void goToNextUnskippedImage(int imageView);
     void goToPreviousUnskippedImage(int imageView);
+    // Returns the nearest unskipped image after or before the image in the selected group, passing over
+    // images shown in any view, or -1 if there is none.
+    int findUnskippedImage(int id, bool forward) const;
 
     void beginControlPanelSection(const char* label);
     void beginSection(const char* label, float padding, float outerWidth);
@@ -0,0 +1,794 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "arena.h"
+// Route stb_image allocations through the decode arena so the large output buffers are reused
+// between images instead of being mapped and page-faulted in for every decode.
+#define STBI_MALLOC(size) Arena::allocate(size)
+#define STBI_REALLOC(pointer, size) Arena::reallocate(pointer, size)
+#define STBI_FREE(pointer) Arena::release(pointer)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include "jpeg.h"
+
+/*
+The planar path uses the JPEG decoder internal to stb_image, stopping after the components are
+decoded and before stb_image upsamples and color converts them into interleaved pixels. This is
+why the stb_image implementation lives in this file.
+*/
+namespace Jpeg {
+	namespace {
+		struct Decoder {
+			stbi__context context;
+			stbi__jpeg jpeg;
+		};
+
+		/*
+		Returns true if the decoder's frame header describes a Y, Cb, Cr image with both chroma
+		planes sampled at the same integer fraction of the Y plane.
+		*/
+		bool getChromaSubsampling(const stbi__jpeg& jpeg, glm::ivec2& subsampling) {
+			if (jpeg.s->img_n != 3) return false;
+
+			// The same check stb_image uses to identify images that store RGB instead of YCbCr
+			if (jpeg.rgb == 3 || (jpeg.app14_color_transform == 0 && !jpeg.jfif)) return false;
+
+			const auto& y = jpeg.img_comp[0];
+			const auto& cb = jpeg.img_comp[1];
+			const auto& cr = jpeg.img_comp[2];
+			if (cb.h != cr.h || cb.v != cr.v) return false;
+			if (y.h % cb.h != 0 || y.v % cb.v != 0) return false;
+
+			subsampling = glm::ivec2(y.h / cb.h, y.v / cb.v);
+			return true;
+		}
+
+		unsigned char clampToByte(int value) {
+			return static_cast<unsigned char>(std::clamp(value, 0, 255));
+		}
+
+		// JFIF full range conversion with coefficients in 16.16 fixed point
+		void writeRGB(int luma, int cb, int cr, unsigned char* output) {
+			const int cbValue = cb - 128;
+			const int crValue = cr - 128;
+			output[0] = clampToByte(luma + ((91881 * crValue + 32768) >> 16));
+			output[1] = clampToByte(luma - ((22554 * cbValue + 46802 * crValue + 32768) >> 16));
+			output[2] = clampToByte(luma + ((116130 * cbValue + 32768) >> 16));
+		}
+
+		// Runs `task` once for each part in [0, count), using the calling thread and count - 1 additional threads.
+		template<typename Task>
+		void runParallel(int count, const Task& task) {
+			std::vector<std::thread> threads;
+			for (int part = 1; part < count; part++) {
+				threads.emplace_back(task, part);
+			}
+			task(0);
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+
+		unsigned char* readFile(const std::string& path, int& size) {
+			FILE* file = stbi__fopen(path.c_str(), "rb");
+			if (!file) return nullptr;
+
+			fseek(file, 0, SEEK_END);
+			long length = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			unsigned char* data = length > 0 ? static_cast<unsigned char*>(Arena::allocate(length)) : nullptr;
+			if (data && fread(data, 1, length, file) != static_cast<size_t>(length)) {
+				Arena::release(data);
+				data = nullptr;
+			}
+			fclose(file);
+
+			size = static_cast<int>(length);
+			return data;
+		}
+
+		int getBlocksPerMCU(const stbi__jpeg& jpeg) {
+			int blocks = 0;
+			for (int k = 0; k < jpeg.scan_n; k++) {
+				const auto& component = jpeg.img_comp[jpeg.order[k]];
+				blocks += component.h * component.v;
+			}
+			return blocks;
+		}
+
+		/*
+		Entropy decodes the blocks of one MCU in an interleaved baseline scan. Each block is passed to
+		`output` along with its component and position in the component's data. Mirrors the loop in
+		stb_image's stbi__parse_entropy_coded_data.
+		*/
+		template<typename Output>
+		bool decodeMCU(stbi__jpeg& jpeg, int mcuX, int mcuY, short* data, const Output& output) {
+			for (int k = 0; k < jpeg.scan_n; k++) {
+				int n = jpeg.order[k];
+				auto& component = jpeg.img_comp[n];
+				for (int y = 0; y < component.v; y++) {
+					for (int x = 0; x < component.h; x++) {
+						int x2 = (mcuX * component.h + x) * 8;
+						int y2 = (mcuY * component.v + y) * 8;
+						int ha = component.ha;
+						if (!stbi__jpeg_decode_block(&jpeg, data, jpeg.huff_dc + component.hd, jpeg.huff_ac + ha, jpeg.fast_ac[ha], n, jpeg.dequant[component.tq])) {
+							return false;
+						}
+						output(component, x2, y2, data);
+					}
+				}
+			}
+			return true;
+		}
+
+		/*
+		Finds the start of every restart interval in a scan's entropy coded data, and the marker that
+		ends the scan. Returns false if the end of the data is reached first.
+		*/
+		bool findRestartIntervals(const unsigned char* data, const unsigned char* dataEnd, std::vector<const unsigned char*>& intervals, const unsigned char*& scanEnd) {
+			intervals.push_back(data);
+			const unsigned char* position = data;
+			while (position + 1 < dataEnd) {
+				position = static_cast<const unsigned char*>(memchr(position, 0xFF, dataEnd - position - 1));
+				if (!position) return false;
+
+				unsigned char next = position[1];
+				if (next == 0x00) {
+					// Stuffed zero after an 0xFF data byte
+					position += 2;
+				} else if (next == 0xFF) {
+					// Fill byte before a marker
+					position += 1;
+				} else if (STBI__RESTART(next)) {
+					position += 2;
+					intervals.push_back(position);
+				} else {
+					scanEnd = position;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/*
+		Decodes an interleaved baseline scan by giving each thread a contiguous range of restart intervals.
+		The decoder state is reset at every restart marker, so each range can start from a copy of the
+		decoder with its own input position, sharing the tables and component buffers.
+		*/
+		bool decodeRestartIntervals(stbi__jpeg& jpeg, int threadCount) {
+			const int mcuCount = jpeg.img_mcu_x * jpeg.img_mcu_y;
+			const int intervalCount = (mcuCount + jpeg.restart_interval - 1) / jpeg.restart_interval;
+
+			std::vector<const unsigned char*> intervals;
+			const unsigned char* scanEnd = nullptr;
+			if (!findRestartIntervals(jpeg.s->img_buffer, jpeg.s->img_buffer_end, intervals, scanEnd) || static_cast<int>(intervals.size()) != intervalCount) {
+				return false;
+			}
+
+			threadCount = std::min(threadCount, intervalCount);
+			std::vector<char> results(threadCount, 0);
+			runParallel(threadCount, [&](int part) {
+				const int firstInterval = part * intervalCount / threadCount;
+				const int endInterval = (part + 1) * intervalCount / threadCount;
+				const unsigned char* start = intervals[firstInterval];
+				const unsigned char* end = endInterval < intervalCount ? intervals[endInterval] : scanEnd;
+
+				stbi__context context;
+				stbi__start_mem(&context, start, static_cast<int>(end - start));
+				stbi__jpeg* partJpeg = new stbi__jpeg(jpeg);
+				partJpeg->s = &context;
+				stbi__jpeg_reset(partJpeg);
+
+				alignas(16) short data[64];
+				const int endMCU = std::min(endInterval * jpeg.restart_interval, mcuCount);
+				bool success = true;
+				for (int mcu = firstInterval * jpeg.restart_interval; mcu < endMCU && success; mcu++) {
+					success = decodeMCU(*partJpeg, mcu % jpeg.img_mcu_x, mcu / jpeg.img_mcu_x, data, [partJpeg](auto& component, int x2, int y2, short* block) {
+						partJpeg->idct_block_kernel(component.data + component.w2 * y2 + x2, component.w2, block);
+					});
+
+					if (success && --partJpeg->todo <= 0) {
+						if (partJpeg->code_bits < 24) stbi__grow_buffer_unsafe(partJpeg);
+						if (mcu + 1 < endMCU && !STBI__RESTART(partJpeg->marker)) success = false;
+						stbi__jpeg_reset(partJpeg);
+					}
+				}
+
+				delete partJpeg;
+				results[part] = success;
+			});
+
+			// Continue reading the file from the marker after the scan
+			jpeg.s->img_buffer = const_cast<unsigned char*>(scanEnd);
+			jpeg.marker = STBI__MARKER_none;
+			return std::all_of(results.begin(), results.end(), [](char result) { return result != 0; });
+		}
+
+		/*
+		Decodes an interleaved baseline scan with entropy decoding on the calling thread and the inverse
+		DCT on the other threads. Coefficients are passed in bands of one MCU row through a ring of buffers,
+		so the inverse DCT of earlier rows runs while later rows are entropy decoded.
+		*/
+		bool decodePipelined(stbi__jpeg& jpeg, int threadCount) {
+			const int bandShorts = jpeg.img_mcu_x * getBlocksPerMCU(jpeg) * 64;
+			const int slotCount = threadCount * 2;
+			short* coefficients = static_cast<short*>(Arena::allocate(static_cast<size_t>(slotCount) * bandShorts * sizeof(short)));
+			if (!coefficients) return false;
+
+			std::mutex mutex;
+			std::condition_variable condition;
+			std::vector<char> slotFree(slotCount, 1);
+			int decodedBands = 0;
+			int nextBand = 0;
+			// Lowered if the scan ends before its last MCU row
+			int bandCount = jpeg.img_mcu_y;
+			bool failed = false;
+
+			auto transformBands = [&](int) {
+				while (true) {
+					int band;
+					{
+						std::unique_lock<std::mutex> lock(mutex);
+						condition.wait(lock, [&]() { return failed || nextBand < decodedBands || nextBand == bandCount; });
+						if (failed || nextBand == bandCount) return;
+						band = nextBand++;
+					}
+
+					const short* block = coefficients + static_cast<size_t>(band % slotCount) * bandShorts;
+					for (int mcuX = 0; mcuX < jpeg.img_mcu_x; mcuX++) {
+						for (int k = 0; k < jpeg.scan_n; k++) {
+							const auto& component = jpeg.img_comp[jpeg.order[k]];
+							for (int y = 0; y < component.v; y++) {
+								for (int x = 0; x < component.h; x++) {
+									int x2 = (mcuX * component.h + x) * 8;
+									int y2 = (band * component.v + y) * 8;
+									jpeg.idct_block_kernel(component.data + component.w2 * y2 + x2, component.w2, const_cast<short*>(block));
+									block += 64;
+								}
+							}
+						}
+					}
+
+					{
+						std::lock_guard<std::mutex> guard(mutex);
+						slotFree[band % slotCount] = 1;
+					}
+					condition.notify_all();
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (int i = 1; i < threadCount; i++) {
+				threads.emplace_back(transformBands, i);
+			}
+
+			stbi__jpeg_reset(&jpeg);
+			bool success = true;
+			bool scanEnded = false;
+			for (int band = 0; band < jpeg.img_mcu_y && success && !scanEnded; band++) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait(lock, [&]() { return slotFree[band % slotCount] != 0; });
+					slotFree[band % slotCount] = 0;
+				}
+
+				// Each block is decoded into a scratch block, then copied to its own place in the band
+				short* block = coefficients + static_cast<size_t>(band % slotCount) * bandShorts;
+				alignas(16) short data[64];
+				for (int mcuX = 0; mcuX < jpeg.img_mcu_x && success && !scanEnded; mcuX++) {
+					success = decodeMCU(jpeg, mcuX, band, data, [&block](auto&, int, int, short* decoded) {
+						memcpy(block, decoded, 64 * sizeof(short));
+						block += 64;
+					});
+
+					if (success && --jpeg.todo <= 0) {
+						if (jpeg.code_bits < 24) stbi__grow_buffer_unsafe(&jpeg);
+						// Without a restart marker here the scan has ended, even if early
+						scanEnded = !STBI__RESTART(jpeg.marker);
+						if (!scanEnded) stbi__jpeg_reset(&jpeg);
+					}
+				}
+
+				{
+					std::lock_guard<std::mutex> guard(mutex);
+					failed = !success;
+					decodedBands = band + 1;
+					if (scanEnded) bandCount = decodedBands;
+				}
+				condition.notify_all();
+			}
+
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+			Arena::release(coefficients);
+			return success;
+		}
+
+#if defined(JPEG_VERIFY_THREADED_DECODE)
+		/*
+		Decodes a scan again with stb_image's single threaded decoder, and reports any difference from the
+		threaded decode already in the component buffers. Only built when JPEG_VERIFY_THREADED_DECODE is
+		defined, since it doubles the decode time. Corrupt files may legitimately differ, so differences are
+		logged rather than asserted. Returns whether stb_image decoded the scan, whose output is kept.
+		*/
+		bool verifyScan(stbi__jpeg& jpeg, const unsigned char* scanStart) {
+			std::vector<std::vector<unsigned char>> threaded;
+			for (int k = 0; k < jpeg.scan_n; k++) {
+				const auto& component = jpeg.img_comp[jpeg.order[k]];
+				threaded.emplace_back(component.data, component.data + static_cast<size_t>(component.w2) * component.h2);
+			}
+
+			jpeg.s->img_buffer = const_cast<unsigned char*>(scanStart);
+			if (!stbi__parse_entropy_coded_data(&jpeg)) {
+				std::cout << "Threaded decode of a scan succeeded, but the single threaded decode failed" << std::endl;
+				return false;
+			}
+			for (int k = 0; k < jpeg.scan_n; k++) {
+				const auto& component = jpeg.img_comp[jpeg.order[k]];
+				if (memcmp(threaded[k].data(), component.data, threaded[k].size()) != 0) {
+					std::cout << "Threaded decode of component " << jpeg.order[k] << " doesn't match the single threaded decode" << std::endl;
+				}
+			}
+			return true;
+		}
+#endif
+
+		// Dequantizes and transforms the coefficients of a progressive image, split into bands of block rows.
+		void finishProgressive(stbi__jpeg& jpeg, int threadCount) {
+			runParallel(threadCount, [&](int part) {
+				for (int n = 0; n < jpeg.s->img_n; n++) {
+					auto& component = jpeg.img_comp[n];
+					const int width = (component.x + 7) >> 3;
+					const int height = (component.y + 7) >> 3;
+					for (int j = part * height / threadCount; j < (part + 1) * height / threadCount; j++) {
+						for (int i = 0; i < width; i++) {
+							short* data = component.coeff + 64 * (i + j * component.coeff_w);
+							stbi__jpeg_dequantize(data, jpeg.dequant[component.tq]);
+							jpeg.idct_block_kernel(component.data + component.w2 * j * 8 + i * 8, component.w2, data);
+						}
+					}
+				}
+			});
+		}
+
+		/*
+		Decodes every scan of the image into the component buffers. Follows stb_image's
+		stbi__decode_jpeg_image, but splits interleaved baseline scans and the final transform of
+		progressive images across threads. Decoding with more than one thread requires the decoder
+		to read from memory.
+		*/
+		bool decodeImage(stbi__jpeg& jpeg, int threadCount) {
+			for (int i = 0; i < 4; i++) {
+				jpeg.img_comp[i].raw_data = nullptr;
+				jpeg.img_comp[i].raw_coeff = nullptr;
+			}
+			jpeg.restart_interval = 0;
+			if (!stbi__decode_jpeg_header(&jpeg, STBI__SCAN_load)) return false;
+
+			int marker = stbi__get_marker(&jpeg);
+			while (!stbi__EOI(marker)) {
+				if (stbi__SOS(marker)) {
+					if (!stbi__process_scan_header(&jpeg)) return false;
+
+					bool decoded = false;
+					if (threadCount > 1 && !jpeg.progressive && jpeg.scan_n > 1) {
+						// Restart intervals are decoded fully in parallel. Without them, or if the markers
+						// don't match the interval, only the inverse DCT is moved to other threads.
+						const unsigned char* scanStart = jpeg.s->img_buffer;
+						decoded = jpeg.restart_interval > 0 && decodeRestartIntervals(jpeg, threadCount);
+						if (!decoded) {
+							jpeg.s->img_buffer = const_cast<unsigned char*>(scanStart);
+							decoded = decodePipelined(jpeg, threadCount);
+						}
+#if defined(JPEG_VERIFY_THREADED_DECODE)
+						if (decoded) decoded = verifyScan(jpeg, scanStart);
+#endif
+					} else {
+						decoded = stbi__parse_entropy_coded_data(&jpeg);
+					}
+					if (!decoded) return false;
+
+					if (jpeg.marker == STBI__MARKER_none) {
+						jpeg.marker = stbi__skip_jpeg_junk_at_end(&jpeg);
+					}
+					marker = stbi__get_marker(&jpeg);
+					if (STBI__RESTART(marker)) {
+						marker = stbi__get_marker(&jpeg);
+					}
+				} else if (stbi__DNL(marker)) {
+					int length = stbi__get16be(jpeg.s);
+					int height = stbi__get16be(jpeg.s);
+					if (length != 4 || height != static_cast<int>(jpeg.s->img_y)) return false;
+					marker = stbi__get_marker(&jpeg);
+				} else {
+					if (!stbi__process_marker(&jpeg, marker)) return true;
+					marker = stbi__get_marker(&jpeg);
+				}
+			}
+
+			if (jpeg.progressive) {
+				finishProgressive(jpeg, threadCount);
+			}
+			return true;
+		}
+		/*
+		Decodes only the MCUs of an interleaved baseline scan that cover a region, into crop buffers holding
+		whole MCUs. Every block before the region's last MCU is still entropy decoded to keep the decoder in
+		step, but only blocks within the region are transformed, and decoding stops after the region. With
+		restart markers, each MCU row of the region starts from the restart interval containing its first
+		MCU, skipping the entropy coded data between rows.
+		*/
+		bool decodeScanRegion(stbi__jpeg& jpeg, glm::ivec2 firstMCU, glm::ivec2 endMCU, unsigned char* const crops[3], const int strides[3]) {
+			const int mcuCount = jpeg.img_mcu_x * jpeg.img_mcu_y;
+			std::vector<const unsigned char*> intervals;
+			if (jpeg.restart_interval > 0) {
+				const int intervalCount = (mcuCount + jpeg.restart_interval - 1) / jpeg.restart_interval;
+				const unsigned char* scanEnd = nullptr;
+				if (!findRestartIntervals(jpeg.s->img_buffer, jpeg.s->img_buffer_end, intervals, scanEnd) || static_cast<int>(intervals.size()) != intervalCount) {
+					intervals.clear();
+				}
+			}
+
+			stbi__jpeg_reset(&jpeg);
+			alignas(16) short data[64];
+			int mcu = 0;
+			for (int row = firstMCU.y; row < endMCU.y; row++) {
+				const int rowStart = row * jpeg.img_mcu_x + firstMCU.x;
+				const int rowEnd = row * jpeg.img_mcu_x + endMCU.x;
+				const int interval = intervals.empty() ? 0 : rowStart / jpeg.restart_interval;
+				if (interval * jpeg.restart_interval > mcu) {
+					jpeg.s->img_buffer = const_cast<unsigned char*>(intervals[interval]);
+					mcu = interval * jpeg.restart_interval;
+					stbi__jpeg_reset(&jpeg);
+				}
+
+				for (; mcu < rowEnd; mcu++) {
+					const int mcuX = mcu % jpeg.img_mcu_x;
+					const int mcuY = mcu / jpeg.img_mcu_x;
+					const bool inRegion = mcuY == row && mcuX >= firstMCU.x;
+					bool decoded = decodeMCU(jpeg, mcuX, mcuY, data, [&](auto& component, int x2, int y2, short* block) {
+						if (!inRegion) return;
+						const int n = static_cast<int>(&component - jpeg.img_comp);
+						const int cropX = x2 - firstMCU.x * component.h * 8;
+						const int cropY = y2 - firstMCU.y * component.v * 8;
+						jpeg.idct_block_kernel(crops[n] + strides[n] * cropY + cropX, strides[n], block);
+					});
+					if (!decoded) return false;
+
+					if (--jpeg.todo <= 0) {
+						if (jpeg.code_bits < 24) stbi__grow_buffer_unsafe(&jpeg);
+						if (mcu + 1 < mcuCount && !STBI__RESTART(jpeg.marker)) return false;
+						stbi__jpeg_reset(&jpeg);
+					}
+				}
+			}
+			return true;
+		}
+
+		/*
+		The two chroma samples on either side of a pixel, and the weight of the second out of 256. Chroma samples
+		are centered on the pixels they cover, and positions past the plane edges use the edge sample.
+		*/
+		struct ChromaTaps {
+			int first;
+			int second;
+			int weight;
+		};
+
+		ChromaTaps getChromaTaps(int position, int subsampling, int planeSize) {
+			const int scaled = (2 * position + 1) * 128 / subsampling - 128;
+			const int index = scaled >> 8;
+			return ChromaTaps{
+				.first = std::clamp(index, 0, planeSize - 1),
+				.second = std::clamp(index + 1, 0, planeSize - 1),
+				.weight = scaled & 255
+			};
+		}
+
+		/*
+		Writes the pixels of a region of Y, Cb and Cr planes as interleaved RGB. Chroma is interpolated
+		bilinearly between samples, matching how the image view samples the chroma textures of a full
+		decode. `origin` is the position of the region within the planes, which must start on a chroma
+		sample boundary.
+		*/
+		void writeRegionRGB(const Plane planes[3], glm::ivec2 subsampling, glm::ivec2 origin, glm::ivec2 size, unsigned char* destination) {
+			std::vector<ChromaTaps> columnTaps(size.x);
+			for (int column = 0; column < size.x; column++) {
+				columnTaps[column] = getChromaTaps(origin.x + column, subsampling.x, planes[1].size.x);
+			}
+
+			for (int row = 0; row < size.y; row++) {
+				unsigned char* output = destination + static_cast<size_t>(row) * size.x * 3;
+				const int y = origin.y + row;
+				const ChromaTaps rowTaps = getChromaTaps(y, subsampling.y, planes[1].size.y);
+				const unsigned char* yRow = planes[0].data + static_cast<size_t>(y) * planes[0].stride;
+				const unsigned char* chromaRows[2][2];
+				for (int i = 0; i < 2; i++) {
+					chromaRows[i][0] = planes[i + 1].data + static_cast<size_t>(rowTaps.first) * planes[i + 1].stride;
+					chromaRows[i][1] = planes[i + 1].data + static_cast<size_t>(rowTaps.second) * planes[i + 1].stride;
+				}
+
+				for (int column = 0; column < size.x; column++) {
+					const ChromaTaps& taps = columnTaps[column];
+					int chroma[2];
+					for (int i = 0; i < 2; i++) {
+						const int top = chromaRows[i][0][taps.first] * (256 - taps.weight) + chromaRows[i][0][taps.second] * taps.weight;
+						const int bottom = chromaRows[i][1][taps.first] * (256 - taps.weight) + chromaRows[i][1][taps.second] * taps.weight;
+						chroma[i] = (top * (256 - rowTaps.weight) + bottom * rowTaps.weight + 32768) >> 16;
+					}
+					writeRGB(yRow[origin.x + column], chroma[0], chroma[1], output);
+					output += 3;
+				}
+			}
+		}
+
+		/*
+		Decodes a region of a planar image whose first scan is an interleaved baseline scan of all components.
+		Sets `fullDecodeRequired` and returns false for other images, such as progressive or non-planar ones,
+		which can't be decoded in part.
+		*/
+		bool decodeRegionImage(stbi__jpeg& jpeg, glm::ivec2 offset, glm::ivec2 size, unsigned char* destination, bool& fullDecodeRequired) {
+			fullDecodeRequired = false;
+			for (int i = 0; i < 4; i++) {
+				jpeg.img_comp[i].raw_data = nullptr;
+				jpeg.img_comp[i].raw_coeff = nullptr;
+			}
+			jpeg.restart_interval = 0;
+			if (!stbi__decode_jpeg_header(&jpeg, STBI__SCAN_load)) return false;
+
+			const glm::ivec2 imageSize(jpeg.s->img_x, jpeg.s->img_y);
+			if (offset.x < 0 || offset.y < 0 || size.x <= 0 || size.y <= 0 || offset.x + size.x > imageSize.x || offset.y + size.y > imageSize.y) {
+				return false;
+			}
+			glm::ivec2 subsampling;
+			if (!getChromaSubsampling(jpeg, subsampling)) {
+				fullDecodeRequired = true;
+				return false;
+			}
+
+			int marker = stbi__get_marker(&jpeg);
+			while (!stbi__SOS(marker)) {
+				if (stbi__EOI(marker) || !stbi__process_marker(&jpeg, marker)) return false;
+				marker = stbi__get_marker(&jpeg);
+			}
+			if (!stbi__process_scan_header(&jpeg)) return false;
+			if (jpeg.progressive || jpeg.scan_n != 3) {
+				fullDecodeRequired = true;
+				return false;
+			}
+
+			// One more MCU is decoded on each side of the region where the image continues, so the chroma
+			// interpolation at the region's edges has the neighboring samples.
+			const glm::ivec2 mcuSize(jpeg.img_h_max * 8, jpeg.img_v_max * 8);
+			const glm::ivec2 firstMCU = glm::max(offset / mcuSize - 1, glm::ivec2(0, 0));
+			const glm::ivec2 endMCU = glm::min((offset + size + mcuSize - 1) / mcuSize + 1, glm::ivec2(jpeg.img_mcu_x, jpeg.img_mcu_y));
+			const glm::ivec2 mcuCount = endMCU - firstMCU;
+
+			unsigned char* crops[3];
+			int strides[3];
+			Plane planes[3];
+			size_t cropBytes = 0;
+			for (int n = 0; n < 3; n++) {
+				const auto& component = jpeg.img_comp[n];
+				strides[n] = mcuCount.x * component.h * 8;
+				cropBytes += static_cast<size_t>(strides[n]) * mcuCount.y * component.v * 8;
+			}
+			unsigned char* cropData = static_cast<unsigned char*>(Arena::allocate(cropBytes));
+			if (!cropData) return false;
+
+			unsigned char* crop = cropData;
+			for (int n = 0; n < 3; n++) {
+				const auto& component = jpeg.img_comp[n];
+				crops[n] = crop;
+				// Samples past the component's edge are only padding
+				const glm::ivec2 cropOrigin = firstMCU * glm::ivec2(component.h, component.v) * 8;
+				planes[n] = Plane{
+					.data = crop,
+					.size = glm::min(mcuCount * glm::ivec2(component.h, component.v) * 8, glm::ivec2(component.x, component.y) - cropOrigin),
+					.stride = strides[n]
+				};
+				crop += static_cast<size_t>(strides[n]) * mcuCount.y * component.v * 8;
+			}
+
+			bool decoded = decodeScanRegion(jpeg, firstMCU, endMCU, crops, strides);
+			if (decoded) {
+				writeRegionRGB(planes, subsampling, offset - firstMCU * mcuSize, size, destination);
+			}
+			Arena::release(cropData);
+			return decoded;
+		}
+	}
+
+	bool readInfo(const std::string& path, JpegInfo& info) {
+		FILE* file = stbi__fopen(path.c_str(), "rb");
+		if (!file) return false;
+
+		Decoder* decoder = new Decoder();
+		stbi__start_file(&decoder->context, file);
+		decoder->jpeg.s = &decoder->context;
+		bool success = stbi__decode_jpeg_header(&decoder->jpeg, STBI__SCAN_header) == 1;
+		fclose(file);
+
+		if (success) {
+			info.size = glm::ivec2(decoder->context.img_x, decoder->context.img_y);
+			info.components = decoder->context.img_n;
+			info.chromaSubsampling = glm::ivec2(1, 1);
+			info.planar = getChromaSubsampling(decoder->jpeg, info.chromaSubsampling);
+		}
+
+		delete decoder;
+		return success;
+	}
+
+	bool decodePlanar(const std::string& path, PlanarImage& image, int threadCount) {
+		Decoder* decoder = new Decoder();
+		FILE* file = nullptr;
+		unsigned char* fileData = nullptr;
+		if (threadCount > 1) {
+			// Splitting a scan needs random access to its entropy coded data, so the whole file is read first
+			int fileSize = 0;
+			fileData = readFile(path, fileSize);
+			if (fileData) {
+				stbi__start_mem(&decoder->context, fileData, fileSize);
+			}
+		} else {
+			file = stbi__fopen(path.c_str(), "rb");
+			if (file) {
+				stbi__start_file(&decoder->context, file);
+			}
+		}
+
+		if (!file && !fileData) {
+			delete decoder;
+			return false;
+		}
+
+		decoder->jpeg.s = &decoder->context;
+		stbi__setup_jpeg(&decoder->jpeg);
+		// The component count is set by the frame header. Clearing it keeps cleanup safe if decoding fails before then.
+		decoder->context.img_n = 0;
+		bool decoded = decodeImage(decoder->jpeg, threadCount);
+		if (file) fclose(file);
+		if (fileData) Arena::release(fileData);
+
+		glm::ivec2 subsampling;
+		if (!decoded || !getChromaSubsampling(decoder->jpeg, subsampling)) {
+			stbi__cleanup_jpeg(&decoder->jpeg);
+			delete decoder;
+			return false;
+		}
+
+		image.size = glm::ivec2(decoder->context.img_x, decoder->context.img_y);
+		image.chromaSubsampling = subsampling;
+		for (int i = 0; i < 3; i++) {
+			const auto& component = decoder->jpeg.img_comp[i];
+			image.planes[i] = Plane{
+				.data = component.data,
+				.size = glm::ivec2(component.x, component.y),
+				.stride = component.w2
+			};
+		}
+		image.decoder = decoder;
+		return true;
+	}
+
+	bool decodeRegion(const std::string& path, glm::ivec2 offset, glm::ivec2 size, unsigned char* destination) {
+		// Skipping to restart intervals needs random access to the entropy coded data
+		int fileSize = 0;
+		unsigned char* fileData = readFile(path, fileSize);
+		if (!fileData) return false;
+
+		Decoder* decoder = new Decoder();
+		stbi__start_mem(&decoder->context, fileData, fileSize);
+		decoder->jpeg.s = &decoder->context;
+		stbi__setup_jpeg(&decoder->jpeg);
+		decoder->context.img_n = 0;
+
+		bool fullDecodeRequired = false;
+		bool decoded = decodeRegionImage(decoder->jpeg, offset, size, destination, fullDecodeRequired);
+		glm::ivec2 subsampling;
+		const bool planar = fullDecodeRequired && getChromaSubsampling(decoder->jpeg, subsampling);
+		stbi__cleanup_jpeg(&decoder->jpeg);
+		delete decoder;
+
+		if (!decoded && fullDecodeRequired && !planar) {
+			// Grayscale and RGB images are decoded to interleaved RGB by stb_image, then cropped
+			int width = 0;
+			int height = 0;
+			int components = 0;
+			unsigned char* pixels = stbi_load_from_memory(fileData, fileSize, &width, &height, &components, 3);
+			decoded = pixels && offset.x + size.x <= width && offset.y + size.y <= height;
+			if (decoded) {
+				for (int row = 0; row < size.y; row++) {
+					memcpy(destination + static_cast<size_t>(row) * size.x * 3, pixels + (static_cast<size_t>(offset.y + row) * width + offset.x) * 3, static_cast<size_t>(size.x) * 3);
+				}
+			}
+			if (pixels) stbi_image_free(pixels);
+		} else if (!decoded && fullDecodeRequired) {
+			// Decoded in full with the same memory, then cropped
+			decoder = new Decoder();
+			stbi__start_mem(&decoder->context, fileData, fileSize);
+			decoder->jpeg.s = &decoder->context;
+			stbi__setup_jpeg(&decoder->jpeg);
+			decoder->context.img_n = 0;
+			decoded = decodeImage(decoder->jpeg, 1) && getChromaSubsampling(decoder->jpeg, subsampling);
+			if (decoded) {
+				Plane planes[3];
+				for (int i = 0; i < 3; i++) {
+					const auto& component = decoder->jpeg.img_comp[i];
+					planes[i] = Plane{
+						.data = component.data,
+						.size = glm::ivec2(component.x, component.y),
+						.stride = component.w2
+					};
+				}
+				writeRegionRGB(planes, subsampling, offset, size, destination);
+			}
+			stbi__cleanup_jpeg(&decoder->jpeg);
+			delete decoder;
+		}
+
+		Arena::release(fileData);
+		return decoded;
+	}
+
+	void freePlanarImage(PlanarImage& image) {
+		Decoder* decoder = static_cast<Decoder*>(image.decoder);
+		if (!decoder) return;
+		stbi__cleanup_jpeg(&decoder->jpeg);
+		delete decoder;
+		image.decoder = nullptr;
+	}
+
+	void convertToRGBAtChromaResolution(const PlanarImage& image, unsigned char* destination) {
+		const Plane& y = image.planes[0];
+		const Plane& cb = image.planes[1];
+		const Plane& cr = image.planes[2];
+		const glm::ivec2 subsampling = image.chromaSubsampling;
+		const int lumaSamples = subsampling.x * subsampling.y;
+
+		for (int row = 0; row < cb.size.y; row++) {
+			unsigned char* output = destination + static_cast<size_t>(row) * cb.size.x * 3;
+			const unsigned char* cbRow = cb.data + static_cast<size_t>(row) * cb.stride;
+			const unsigned char* crRow = cr.data + static_cast<size_t>(row) * cr.stride;
+
+			for (int column = 0; column < cb.size.x; column++) {
+				// The Y plane is padded to whole blocks, so samples past the right and bottom edges are
+				// still readable for chroma samples covering a partial block.
+				int luma = 0;
+				for (int dy = 0; dy < subsampling.y; dy++) {
+					const unsigned char* yRow = y.data + static_cast<size_t>(row * subsampling.y + dy) * y.stride + column * subsampling.x;
+					for (int dx = 0; dx < subsampling.x; dx++) {
+						luma += yRow[dx];
+					}
+				}
+				luma = (luma + lumaSamples / 2) / lumaSamples;
+
+				writeRGB(luma, cbRow[column], crRow[column], output);
+				output += 3;
+			}
+		}
+	}
+
+	void convertPlanesToRGB(const Plane& y, const Plane& cb, const Plane& cr, unsigned char* destination) {
+		for (int row = 0; row < y.size.y; row++) {
+			unsigned char* output = destination + static_cast<size_t>(row) * y.size.x * 3;
+			const unsigned char* yRow = y.data + static_cast<size_t>(row) * y.stride;
+			const int chromaRow = std::min(row * cb.size.y / y.size.y, cb.size.y - 1);
+			const unsigned char* cbRow = cb.data + static_cast<size_t>(chromaRow) * cb.stride;
+			const unsigned char* crRow = cr.data + static_cast<size_t>(chromaRow) * cr.stride;
+
+			for (int column = 0; column < y.size.x; column++) {
+				const int chromaColumn = std::min(column * cb.size.x / y.size.x, cb.size.x - 1);
+				writeRGB(yRow[column], cbRow[chromaColumn], crRow[chromaColumn], output);
+				output += 3;
+			}
+		}
+	}
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <unordered_set>
+#include "arena.h"
+#include "jpeg.h"
+#include "loupe.h"
+#include "orientation.h"
+
+Loupe::Loupe(int threadCount) : texturePool(maxFreeTextures) {
+	for (int i = 0; i < threadCount; i++) {
+		threads.emplace_back(&Loupe::runDecodeThread, this);
+	}
+}
+
+Loupe::~Loupe() {
+	{
+		std::lock_guard<std::mutex> guard(requestMutex);
+		runThreads = false;
+	}
+	requestConditionVariable.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	clear();
+}
+
+void Loupe::setRegion(const std::vector<const Image*>& images, glm::vec2 center) {
+	std::vector<int> ids;
+	ids.reserve(images.size());
+	for (const Image* image : images) {
+		ids.push_back(image->id);
+	}
+
+	if (ids != imageIDs) {
+		// Crops of images that are no longer shown are released
+		std::unordered_set<int> shown(ids.begin(), ids.end());
+		for (auto crop = crops.begin(); crop != crops.end();) {
+			if (shown.contains(crop->first)) {
+				crop++;
+			} else {
+				releaseCrop(crop->second);
+				crop = crops.erase(crop);
+			}
+		}
+		imageIDs = ids;
+	}
+
+	bool changed = false;
+	for (const Image* image : images) {
+		// The region can't be placed until the image size is known
+		if (!image->fileInfoLoaded || image->size.x <= 0 || image->size.y <= 0) continue;
+
+		// Crops are square, so the same size covers the region in any orientation
+		Region region;
+		region.size = glm::min(image->size, glm::ivec2(cropSize));
+		const glm::vec2 texturePoint = Orientation::displayToTexture(image->orientation, center) * glm::vec2(image->size);
+		region.offset = glm::ivec2(texturePoint - glm::vec2(region.size) / 2.0f + 0.5f);
+		region.offset = glm::clamp(region.offset, glm::ivec2(0), image->size - region.size);
+
+		Crop& crop = crops[image->id];
+		if (!(crop.requested == region)) {
+			crop.requested = region;
+			crop.failed = false;
+			changed = true;
+		}
+	}
+	if (!changed) return;
+
+	// Queued requests for earlier regions are replaced, in the order of the images
+	std::lock_guard<std::mutex> guard(requestMutex);
+	requests.clear();
+	for (const Image* image : images) {
+		auto crop = crops.find(image->id);
+		if (crop == crops.end() || crop->second.failed || crop->second.uploaded == crop->second.requested) continue;
+		requests.push_back(CropRequest{
+			.imageID = image->id,
+			.path = image->path,
+			.region = crop->second.requested
+		});
+	}
+	requestConditionVariable.notify_all();
+}
+
+void Loupe::clear() {
+	{
+		std::lock_guard<std::mutex> guard(requestMutex);
+		requests.clear();
+	}
+	for (auto& [id, crop] : crops) {
+		releaseCrop(crop);
+	}
+	crops.clear();
+	imageIDs.clear();
+}
+
+void Loupe::frameUpdate() {
+	std::vector<CropResult> completed;
+	{
+		std::lock_guard<std::mutex> guard(resultMutex);
+		completed.swap(results);
+	}
+	if (completed.empty()) return;
+
+	for (const CropResult& result : completed) {
+		auto entry = crops.find(result.imageID);
+		if (entry == crops.end() || !(entry->second.requested == result.region)) continue;
+
+		Crop& crop = entry->second;
+		if (result.pixels.empty()) {
+			crop.failed = true;
+			continue;
+		}
+
+		if (crop.texture != 0 && crop.uploaded.size != result.region.size) {
+			texturePool.release(crop.texture);
+			crop.texture = 0;
+		}
+		if (crop.texture == 0) {
+			crop.texture = texturePool.acquire(result.region.size, GL_RGB8);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, crop.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, result.region.size.x, result.region.size.y, GL_RGB, GL_UNSIGNED_BYTE, result.pixels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		crop.uploaded = result.region;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLuint Loupe::getTexture(int id) const {
+	auto crop = crops.find(id);
+	return crop == crops.end() ? 0 : crop->second.texture;
+}
+
+bool Loupe::failed(int id) const {
+	auto crop = crops.find(id);
+	return crop != crops.end() && crop->second.failed;
+}
+
+int Loupe::getPendingCount() const {
+	return static_cast<int>(std::count_if(crops.begin(), crops.end(), [](const auto& entry) {
+		const Crop& crop = entry.second;
+		return !crop.failed && !(crop.uploaded == crop.requested);
+	}));
+}
+
+void Loupe::runDecodeThread() {
+	while (true) {
+		CropRequest request;
+		{
+			std::unique_lock<std::mutex> lock(requestMutex);
+			if (runThreads && requests.empty()) {
+				// Return cached decode buffers while idle
+				lock.unlock();
+				Arena::trim();
+				lock.lock();
+			}
+			requestConditionVariable.wait(lock, [this]() { return !runThreads || !requests.empty(); });
+			if (!runThreads) return;
+			request = std::move(requests.front());
+			requests.pop_front();
+		}
+
+		CropResult result{
+			.imageID = request.imageID,
+			.region = request.region,
+			.pixels = std::vector<unsigned char>(static_cast<size_t>(request.region.size.x) * request.region.size.y * 3)
+		};
+		if (!Jpeg::decodeRegion(request.path, request.region.offset, request.region.size, result.pixels.data())) {
+			result.pixels.clear();
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(resultMutex);
+			results.push_back(std::move(result));
+		}
+		// Wakes the main thread to upload the crop
+		glfwPostEmptyEvent();
+	}
+}
+
+void Loupe::releaseCrop(Crop& crop) {
+	if (crop.texture != 0) {
+		texturePool.release(crop.texture);
+		crop.texture = 0;
+	}
+}
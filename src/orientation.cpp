@@ -0,0 +1,44 @@
+#include "orientation.h"
+
+namespace Orientation {
+	glm::mat3 getDisplayToTexture(int orientation) {
+		// Columns are the texture space contributions of display x, display y, and a constant offset.
+		switch (orientation) {
+		case 2:
+			// Mirrored horizontally
+			return glm::mat3(glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(1, 0, 1));
+		case 3:
+			// Rotated 180 degrees
+			return glm::mat3(glm::vec3(-1, 0, 0), glm::vec3(0, -1, 0), glm::vec3(1, 1, 1));
+		case 4:
+			// Mirrored vertically
+			return glm::mat3(glm::vec3(1, 0, 0), glm::vec3(0, -1, 0), glm::vec3(0, 1, 1));
+		case 5:
+			// Mirrored across the top left to bottom right diagonal
+			return glm::mat3(glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1));
+		case 6:
+			// Displayed rotated 90 degrees clockwise
+			return glm::mat3(glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 1, 1));
+		case 7:
+			// Mirrored across the top right to bottom left diagonal
+			return glm::mat3(glm::vec3(0, -1, 0), glm::vec3(-1, 0, 0), glm::vec3(1, 1, 1));
+		case 8:
+			// Displayed rotated 90 degrees counterclockwise
+			return glm::mat3(glm::vec3(0, 1, 0), glm::vec3(-1, 0, 0), glm::vec3(1, 0, 1));
+		default:
+			return glm::mat3(1.0f);
+		}
+	}
+
+	glm::vec2 displayToTexture(int orientation, glm::vec2 position) {
+		return glm::vec2(getDisplayToTexture(orientation) * glm::vec3(position, 1.0f));
+	}
+
+	bool swapsAxes(int orientation) {
+		return orientation >= 5 && orientation <= 8;
+	}
+
+	glm::ivec2 getDisplaySize(glm::ivec2 size, int orientation) {
+		return swapsAxes(orientation) ? glm::ivec2(size.y, size.x) : size;
+	}
+}
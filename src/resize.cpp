@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "arena.h"
+#include "resize.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define RESIZE_USE_SSE2
+// AVX2 functions are compiled into every x86 build, and only called when the CPU supports them
+#define RESIZE_USE_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define RESIZE_AVX2_FUNCTION
+#else
+#define RESIZE_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RESIZE_USE_NEON
+#endif
+
+namespace Resize {
+	namespace {
+		// Box sums are accumulated in 16 bits, which holds up to 257 rows of 8-bit values.
+		const int maxBoxFactor = 256;
+		const int linearToSRGBTableSize = 4096;
+		const int hashColumns = 9;
+		const int hashRows = 8;
+
+		struct ColorTables {
+			float sRGBToLinear[256];
+			unsigned char linearToSRGB[linearToSRGBTableSize];
+
+			ColorTables() {
+				for (int i = 0; i < 256; i++) {
+					float c = i / 255.0f;
+					sRGBToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+				}
+				for (int i = 0; i < linearToSRGBTableSize; i++) {
+					float c = i / static_cast<float>(linearToSRGBTableSize - 1);
+					float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+					linearToSRGB[i] = static_cast<unsigned char>(std::clamp(s * 255.0f + 0.5f, 0.0f, 255.0f));
+				}
+			}
+		};
+
+		const ColorTables& colorTables() {
+			static const ColorTables tables;
+			return tables;
+		}
+
+		unsigned char encodeSRGB(const ColorTables& tables, float linear) {
+			int index = static_cast<int>(linear * (linearToSRGBTableSize - 1) + 0.5f);
+			return tables.linearToSRGB[std::clamp(index, 0, linearToSRGBTableSize - 1)];
+		}
+
+#if defined(RESIZE_USE_AVX2)
+		bool cpuSupportsAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return false;
+			// The OS must also save the upper halves of the registers, which XGETBV reports
+			__cpuid(info, 1);
+			const int osxsave = 1 << 27;
+			const int avx = 1 << 28;
+			if ((info[2] & osxsave) == 0 || (info[2] & avx) == 0 || (_xgetbv(0) & 6) != 6) return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+
+		const bool useAVX2 = cpuSupportsAVX2();
+
+		// Returns the number of values accumulated, a multiple of 32.
+		RESIZE_AVX2_FUNCTION
+		int accumulateRowAVX2(const unsigned char* row, unsigned short* sums, int count) {
+			int i = 0;
+			for (; i + 32 <= count; i += 32) {
+				__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+				__m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+				__m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+				__m256i* lowSums = reinterpret_cast<__m256i*>(sums + i);
+				__m256i* highSums = reinterpret_cast<__m256i*>(sums + i + 16);
+				_mm256_storeu_si256(lowSums, _mm256_add_epi16(_mm256_loadu_si256(lowSums), low));
+				_mm256_storeu_si256(highSums, _mm256_add_epi16(_mm256_loadu_si256(highSums), high));
+			}
+			return i;
+		}
+#endif
+
+		/*
+		Adds a row of 8-bit values into 16-bit accumulators. This is independent of the channel
+		layout, so the vertical half of the box filter runs over the raw interleaved bytes.
+		*/
+		void accumulateRow(const unsigned char* row, unsigned short* sums, int count) {
+			int i = 0;
+#if defined(RESIZE_USE_AVX2)
+			if (useAVX2) {
+				i = accumulateRowAVX2(row, sums, count);
+			}
+#endif
+#if defined(RESIZE_USE_SSE2)
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= count; i += 16) {
+				__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+				__m128i* lowSums = reinterpret_cast<__m128i*>(sums + i);
+				__m128i* highSums = reinterpret_cast<__m128i*>(sums + i + 8);
+				_mm_storeu_si128(lowSums, _mm_add_epi16(_mm_loadu_si128(lowSums), _mm_unpacklo_epi8(bytes, zero)));
+				_mm_storeu_si128(highSums, _mm_add_epi16(_mm_loadu_si128(highSums), _mm_unpackhi_epi8(bytes, zero)));
+			}
+#elif defined(RESIZE_USE_NEON)
+			for (; i + 16 <= count; i += 16) {
+				uint8x16_t bytes = vld1q_u8(row + i);
+				vst1q_u16(sums + i, vaddw_u8(vld1q_u16(sums + i), vget_low_u8(bytes)));
+				vst1q_u16(sums + i + 8, vaddw_u8(vld1q_u16(sums + i + 8), vget_high_u8(bytes)));
+			}
+#endif
+			for (; i < count; i++) {
+				sums[i] += row[i];
+			}
+		}
+
+		/*
+		Adds each channel of `pixels` consecutive interleaved RGB pixels of 16-bit sums to `total`. Vectors
+		are accumulated in 32 bits over runs of 8 pixels, whose 24 values fill whole vectors with the same
+		channel in the same lanes.
+		*/
+		void sumPixelsRGB(const unsigned short* values, int pixels, unsigned int total[3]) {
+			const int count = pixels * 3;
+			int i = 0;
+#if defined(RESIZE_USE_SSE2)
+			if (count >= 24) {
+				const __m128i zero = _mm_setzero_si128();
+				__m128i sums[3] = { zero, zero, zero };
+				for (; i + 24 <= count; i += 24) {
+					__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+					__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 8));
+					__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + 16));
+					// Values 0-3 and 12-15 hold channels 0, 1, 2, 0, values 4-7 and 16-19 hold 1, 2, 0, 1, and
+					// values 8-11 and 20-23 hold 2, 0, 1, 2.
+					sums[0] = _mm_add_epi32(sums[0], _mm_add_epi32(_mm_unpacklo_epi16(a, zero), _mm_unpackhi_epi16(b, zero)));
+					sums[1] = _mm_add_epi32(sums[1], _mm_add_epi32(_mm_unpackhi_epi16(a, zero), _mm_unpacklo_epi16(c, zero)));
+					sums[2] = _mm_add_epi32(sums[2], _mm_add_epi32(_mm_unpacklo_epi16(b, zero), _mm_unpackhi_epi16(c, zero)));
+				}
+				alignas(16) unsigned int lanes[12];
+				for (int v = 0; v < 3; v++) {
+					_mm_store_si128(reinterpret_cast<__m128i*>(lanes + v * 4), sums[v]);
+				}
+				for (int lane = 0; lane < 12; lane++) {
+					total[lane % 3] += lanes[lane];
+				}
+			}
+#elif defined(RESIZE_USE_NEON)
+			if (count >= 24) {
+				uint32x4_t sums[3] = { vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0) };
+				for (; i + 24 <= count; i += 24) {
+					uint16x8_t a = vld1q_u16(values + i);
+					uint16x8_t b = vld1q_u16(values + i + 8);
+					uint16x8_t c = vld1q_u16(values + i + 16);
+					sums[0] = vaddq_u32(sums[0], vaddl_u16(vget_low_u16(a), vget_high_u16(b)));
+					sums[1] = vaddq_u32(sums[1], vaddl_u16(vget_high_u16(a), vget_low_u16(c)));
+					sums[2] = vaddq_u32(sums[2], vaddl_u16(vget_low_u16(b), vget_high_u16(c)));
+				}
+				unsigned int lanes[12];
+				for (int v = 0; v < 3; v++) {
+					vst1q_u32(lanes + v * 4, sums[v]);
+				}
+				for (int lane = 0; lane < 12; lane++) {
+					total[lane % 3] += lanes[lane];
+				}
+			}
+#endif
+			for (; i < count; i++) {
+				total[i % 3] += values[i];
+			}
+		}
+
+		/*
+		Averages each `factor` x `factor` block of the source into one pixel of `reduced`. Source
+		rows and columns past the last full block are dropped.
+		*/
+		template <int Channels>
+		void boxReduce(const unsigned char* source, glm::ivec2 sourceSize, int factor, unsigned char* reduced, glm::ivec2 reducedSize) {
+			const int sourceStride = sourceSize.x * Channels;
+			const int usedRowLength = reducedSize.x * factor * Channels;
+			const unsigned int divisor = factor * factor;
+			const unsigned int rounding = divisor / 2;
+
+			unsigned short* sums = static_cast<unsigned short*>(Arena::allocate(usedRowLength * sizeof(unsigned short)));
+
+			for (int y = 0; y < reducedSize.y; y++) {
+				memset(sums, 0, usedRowLength * sizeof(unsigned short));
+				const unsigned char* sourceRow = source + static_cast<size_t>(y) * factor * sourceStride;
+				for (int j = 0; j < factor; j++) {
+					accumulateRow(sourceRow + static_cast<size_t>(j) * sourceStride, sums, usedRowLength);
+				}
+
+				unsigned char* reducedRow = reduced + static_cast<size_t>(y) * reducedSize.x * Channels;
+				for (int x = 0; x < reducedSize.x; x++) {
+					const unsigned short* block = sums + x * factor * Channels;
+					unsigned int total[Channels] = {};
+					if constexpr (Channels == 3) {
+						sumPixelsRGB(block, factor, total);
+					} else {
+						for (int i = 0; i < factor; i++) {
+							for (int c = 0; c < Channels; c++) {
+								total[c] += block[i * Channels + c];
+							}
+						}
+					}
+					for (int c = 0; c < Channels; c++) {
+						reducedRow[x * Channels + c] = static_cast<unsigned char>((total[c] + rounding) / divisor);
+					}
+				}
+			}
+
+			Arena::release(sums);
+		}
+
+		/*
+		Weights of an area filter mapping `sourceLength` samples onto `destinationLength` samples.
+		Output sample i reads `count[i]` source samples starting at `first[i]`, with weights stored
+		at `weights[i * maxTaps]`.
+		*/
+		struct AreaFilter {
+			int maxTaps;
+			std::vector<int> first;
+			std::vector<int> count;
+			std::vector<float> weights;
+
+			AreaFilter(int sourceLength, int destinationLength) {
+				const double scale = sourceLength / static_cast<double>(destinationLength);
+				maxTaps = static_cast<int>(ceil(scale)) + 1;
+				first.resize(destinationLength);
+				count.resize(destinationLength);
+				weights.assign(static_cast<size_t>(destinationLength) * maxTaps, 0.0f);
+
+				for (int i = 0; i < destinationLength; i++) {
+					const double start = i * scale;
+					const double end = std::min((i + 1) * scale, static_cast<double>(sourceLength));
+					const int firstIndex = std::min(static_cast<int>(start), sourceLength - 1);
+					const int lastIndex = std::clamp(static_cast<int>(ceil(end)) - 1, firstIndex, sourceLength - 1);
+					first[i] = firstIndex;
+					count[i] = std::min(lastIndex - firstIndex + 1, maxTaps);
+
+					double total = 0.0;
+					for (int t = 0; t < count[i]; t++) {
+						const int s = firstIndex + t;
+						const double overlap = std::min(end, s + 1.0) - std::max(start, static_cast<double>(s));
+						weights[i * maxTaps + t] = static_cast<float>(std::max(overlap, 0.0));
+						total += std::max(overlap, 0.0);
+					}
+					for (int t = 0; t < count[i]; t++) {
+						weights[i * maxTaps + t] = total > 0.0 ? static_cast<float>(weights[i * maxTaps + t] / total) : 1.0f / count[i];
+					}
+				}
+			}
+		};
+
+#if defined(RESIZE_USE_AVX2)
+		// Returns the number of values accumulated, a multiple of 8.
+		RESIZE_AVX2_FUNCTION
+		int accumulateLinearRowAVX2(const unsigned char* row, const float* table, float weight, float* sums, int count) {
+			const __m256 weights = _mm256_set1_ps(weight);
+			int i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i)));
+				__m256 linear = _mm256_i32gather_ps(table, indices, 4);
+				_mm256_storeu_ps(sums + i, _mm256_add_ps(_mm256_loadu_ps(sums + i), _mm256_mul_ps(weights, linear)));
+			}
+			return i;
+		}
+#endif
+
+		// Adds a row of 8-bit sRGB values, converted to linear light and scaled by `weight`, into `sums`.
+		void accumulateLinearRow(const unsigned char* row, const float* table, float weight, float* sums, int count) {
+			int i = 0;
+#if defined(RESIZE_USE_AVX2)
+			if (useAVX2) {
+				i = accumulateLinearRowAVX2(row, table, weight, sums, count);
+			}
+#endif
+#if defined(RESIZE_USE_SSE2)
+			const __m128 weights = _mm_set1_ps(weight);
+			for (; i + 4 <= count; i += 4) {
+				__m128 linear = _mm_setr_ps(table[row[i]], table[row[i + 1]], table[row[i + 2]], table[row[i + 3]]);
+				_mm_storeu_ps(sums + i, _mm_add_ps(_mm_loadu_ps(sums + i), _mm_mul_ps(weights, linear)));
+			}
+#elif defined(RESIZE_USE_NEON)
+			for (; i + 4 <= count; i += 4) {
+				const float values[4] = { table[row[i]], table[row[i + 1]], table[row[i + 2]], table[row[i + 3]] };
+				vst1q_f32(sums + i, vmlaq_n_f32(vld1q_f32(sums + i), vld1q_f32(values), weight));
+			}
+#endif
+			for (; i < count; i++) {
+				sums[i] += weight * table[row[i]];
+			}
+		}
+
+		/*
+		Applies the horizontal area filter to one output pixel of a row of linear RGB values. `sums` must be
+		readable for one value past the last tap, since each tap loads a whole vector.
+		*/
+		void filterPixelRGB(const float* sums, const float* weights, int taps, float total[3]) {
+#if defined(RESIZE_USE_SSE2)
+			__m128 vector = _mm_setzero_ps();
+			for (int t = 0; t < taps; t++) {
+				vector = _mm_add_ps(vector, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(sums + t * 3)));
+			}
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, vector);
+			total[0] = lanes[0];
+			total[1] = lanes[1];
+			total[2] = lanes[2];
+#elif defined(RESIZE_USE_NEON)
+			float32x4_t vector = vdupq_n_f32(0.0f);
+			for (int t = 0; t < taps; t++) {
+				vector = vmlaq_n_f32(vector, vld1q_f32(sums + t * 3), weights[t]);
+			}
+			total[0] = vgetq_lane_f32(vector, 0);
+			total[1] = vgetq_lane_f32(vector, 1);
+			total[2] = vgetq_lane_f32(vector, 2);
+#else
+			total[0] = total[1] = total[2] = 0.0f;
+			for (int t = 0; t < taps; t++) {
+				for (int c = 0; c < 3; c++) {
+					total[c] += weights[t] * sums[t * 3 + c];
+				}
+			}
+#endif
+		}
+
+		void fillBackground(unsigned char* destination, int pixels, glm::ivec3 background) {
+			for (int i = 0; i < pixels; i++) {
+				destination[i * 3 + 0] = static_cast<unsigned char>(background.r);
+				destination[i * 3 + 1] = static_cast<unsigned char>(background.g);
+				destination[i * 3 + 2] = static_cast<unsigned char>(background.b);
+			}
+		}
+
+		/*
+		Area filters `source` down to the content size in linear light, writing the letterboxed
+		result into `destination` row by row.
+		*/
+		template <int Channels>
+		void areaResampleLetterbox(
+			const unsigned char* source, glm::ivec2 sourceSize,
+			unsigned char* destination, glm::ivec2 destinationSize,
+			glm::ivec2 contentOffset, glm::ivec2 contentSize,
+			glm::ivec3 background) {
+			static_assert(Channels == 3, "Letterbox background is only defined for RGB images.");
+
+			const ColorTables& tables = colorTables();
+			const AreaFilter horizontal(sourceSize.x, contentSize.x);
+			const AreaFilter vertical(sourceSize.y, contentSize.y);
+			// Padded by one value for the vector loads of `filterPixelRGB`
+			std::vector<float> rowSums(static_cast<size_t>(sourceSize.x) * Channels + 1);
+
+			const int destinationStride = destinationSize.x * Channels;
+			const int rightBarWidth = destinationSize.x - contentOffset.x - contentSize.x;
+
+			for (int y = 0; y < destinationSize.y; y++) {
+				unsigned char* destinationRow = destination + static_cast<size_t>(y) * destinationStride;
+				const int contentY = y - contentOffset.y;
+				if (contentY < 0 || contentY >= contentSize.y) {
+					fillBackground(destinationRow, destinationSize.x, background);
+					continue;
+				}
+
+				// Vertical pass into a single row of linear values
+				std::fill(rowSums.begin(), rowSums.end(), 0.0f);
+				for (int t = 0; t < vertical.count[contentY]; t++) {
+					const float weight = vertical.weights[contentY * vertical.maxTaps + t];
+					const unsigned char* sourceRow = source + static_cast<size_t>(vertical.first[contentY] + t) * sourceSize.x * Channels;
+					accumulateLinearRow(sourceRow, tables.sRGBToLinear, weight, rowSums.data(), sourceSize.x * Channels);
+				}
+
+				// Horizontal pass, written between the side bars
+				fillBackground(destinationRow, contentOffset.x, background);
+				unsigned char* contentRow = destinationRow + contentOffset.x * Channels;
+				for (int x = 0; x < contentSize.x; x++) {
+					float total[Channels];
+					filterPixelRGB(&rowSums[horizontal.first[x] * Channels], &horizontal.weights[x * horizontal.maxTaps], horizontal.count[x], total);
+					for (int c = 0; c < Channels; c++) {
+						contentRow[x * Channels + c] = encodeSRGB(tables, total[c]);
+					}
+				}
+				fillBackground(contentRow + contentSize.x * Channels, rightBarWidth, background);
+			}
+		}
+
+		template <int Channels, bool BoxPrefilter>
+		void resizeLetterbox(
+			const unsigned char* source, glm::ivec2 sourceSize,
+			unsigned char* destination, glm::ivec2 destinationSize,
+			glm::ivec2 contentOffset, glm::ivec2 contentSize,
+			glm::ivec3 background, int boxFactor, const AnalyzeFunction& analyze) {
+			if constexpr (BoxPrefilter) {
+				const glm::ivec2 reducedSize = sourceSize / boxFactor;
+				unsigned char* reduced = static_cast<unsigned char*>(Arena::allocate(static_cast<size_t>(reducedSize.x) * reducedSize.y * Channels));
+				boxReduce<Channels>(source, sourceSize, boxFactor, reduced, reducedSize);
+				areaResampleLetterbox<Channels>(reduced, reducedSize, destination, destinationSize, contentOffset, contentSize, background);
+				if (analyze) {
+					analyze(reduced, reducedSize);
+				}
+				Arena::release(reduced);
+			} else {
+				areaResampleLetterbox<Channels>(source, sourceSize, destination, destinationSize, contentOffset, contentSize, background);
+				if (analyze) {
+					analyze(source, sourceSize);
+				}
+			}
+		}
+	}
+
+	void resizeLetterboxRGB(
+		const unsigned char* source, glm::ivec2 sourceSize,
+		unsigned char* destination, glm::ivec2 destinationSize,
+		glm::ivec2 contentOffset, glm::ivec2 contentSize,
+		glm::ivec3 background, const AnalyzeFunction& analyze) {
+		// Box filter down to no less than twice the content size, leaving the final reduction to the
+		// linear light filter.
+		const int boxFactor = std::min(std::min(sourceSize.x / contentSize.x, sourceSize.y / contentSize.y) / 2, maxBoxFactor);
+
+		if (boxFactor >= 2) {
+			resizeLetterbox<3, true>(source, sourceSize, destination, destinationSize, contentOffset, contentSize, background, boxFactor, analyze);
+		} else {
+			resizeLetterbox<3, false>(source, sourceSize, destination, destinationSize, contentOffset, contentSize, background, 1, analyze);
+		}
+	}
+
+	void letterboxRGB(
+		const unsigned char* source, glm::ivec2 sourceSize,
+		unsigned char* destination, glm::ivec2 destinationSize,
+		glm::ivec2 contentOffset, glm::ivec3 background) {
+		const int rightBarWidth = destinationSize.x - contentOffset.x - sourceSize.x;
+		for (int y = 0; y < destinationSize.y; y++) {
+			unsigned char* destinationRow = destination + static_cast<size_t>(y) * destinationSize.x * 3;
+			const int sourceY = y - contentOffset.y;
+			if (sourceY < 0 || sourceY >= sourceSize.y) {
+				fillBackground(destinationRow, destinationSize.x, background);
+				continue;
+			}
+
+			fillBackground(destinationRow, contentOffset.x, background);
+			memcpy(destinationRow + contentOffset.x * 3, source + static_cast<size_t>(sourceY) * sourceSize.x * 3, static_cast<size_t>(sourceSize.x) * 3);
+			fillBackground(destinationRow + (contentOffset.x + sourceSize.x) * 3, rightBarWidth, background);
+		}
+	}
+
+	unsigned long long differenceHash(const unsigned char* source, glm::ivec2 sourceSize) {
+		if (sourceSize.x < hashColumns || sourceSize.y < hashRows) return 0;
+
+		const int rowLength = sourceSize.x * 3;
+		unsigned short* sums = static_cast<unsigned short*>(Arena::allocate(rowLength * sizeof(unsigned short)));
+		unsigned int* bandSums = static_cast<unsigned int*>(Arena::allocate(rowLength * sizeof(unsigned int)));
+
+		unsigned long long hash = 0;
+		for (int band = 0; band < hashRows; band++) {
+			const int top = band * sourceSize.y / hashRows;
+			const int bottom = (band + 1) * sourceSize.y / hashRows;
+
+			// Sum the band's rows with the vectorized accumulator, flushing before the 16-bit sums can overflow
+			memset(bandSums, 0, rowLength * sizeof(unsigned int));
+			for (int y = top; y < bottom; y += maxBoxFactor) {
+				const int end = std::min(y + maxBoxFactor, bottom);
+				memset(sums, 0, rowLength * sizeof(unsigned short));
+				for (int j = y; j < end; j++) {
+					accumulateRow(source + static_cast<size_t>(j) * rowLength, sums, rowLength);
+				}
+				for (int i = 0; i < rowLength; i++) {
+					bandSums[i] += sums[i];
+				}
+			}
+
+			// Average luma of each cell. Cells in a band have the same height, so only the width varies.
+			float luma[hashColumns];
+			for (int cell = 0; cell < hashColumns; cell++) {
+				const int left = cell * sourceSize.x / hashColumns;
+				const int right = (cell + 1) * sourceSize.x / hashColumns;
+				unsigned long long total[3] = {};
+				for (int x = left; x < right; x++) {
+					for (int c = 0; c < 3; c++) {
+						total[c] += bandSums[x * 3 + c];
+					}
+				}
+				luma[cell] = (0.299f * total[0] + 0.587f * total[1] + 0.114f * total[2]) / (right - left);
+			}
+
+			for (int cell = 0; cell < hashColumns - 1; cell++) {
+				hash = (hash << 1) | (luma[cell] > luma[cell + 1] ? 1ull : 0ull);
+			}
+		}
+
+		Arena::release(bandSums);
+		Arena::release(sums);
+		return hash;
+	}
+}
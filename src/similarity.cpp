@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include "similarity.h"
+
+namespace Similarity {
+	namespace {
+		int hammingDistance(unsigned long long a, unsigned long long b) {
+			return std::popcount(a ^ b);
+		}
+	}
+
+	void insert(BKTree& tree, int id, unsigned long long hash) {
+		if (!tree.ids.insert(id).second) return;
+
+		Node newNode{
+			.hash = hash,
+			.id = id,
+			.distance = 0,
+			.firstChild = -1,
+			.nextSibling = -1
+		};
+		const int newIndex = static_cast<int>(tree.nodes.size());
+		if (tree.nodes.empty()) {
+			tree.nodes.push_back(newNode);
+			return;
+		}
+
+		// Walk down the children at the matching distance until there is no child at that distance
+		int current = 0;
+		while (true) {
+			const int distance = hammingDistance(tree.nodes[current].hash, hash);
+			int child = tree.nodes[current].firstChild;
+			while (child != -1 && tree.nodes[child].distance != distance) {
+				child = tree.nodes[child].nextSibling;
+			}
+
+			if (child == -1) {
+				newNode.distance = distance;
+				newNode.nextSibling = tree.nodes[current].firstChild;
+				tree.nodes.push_back(newNode);
+				tree.nodes[current].firstChild = newIndex;
+				return;
+			}
+			current = child;
+		}
+	}
+
+	void findWithin(const BKTree& tree, unsigned long long hash, int maxDistance, std::vector<Match>& matches) {
+		matches.clear();
+		if (tree.nodes.empty()) return;
+
+		std::vector<int> stack{ 0 };
+		while (!stack.empty()) {
+			const Node& node = tree.nodes[stack.back()];
+			stack.pop_back();
+
+			const int distance = hammingDistance(node.hash, hash);
+			if (distance <= maxDistance) {
+				matches.push_back(Match{ .id = node.id, .distance = distance });
+			}
+
+			for (int child = node.firstChild; child != -1; child = tree.nodes[child].nextSibling) {
+				if (std::abs(tree.nodes[child].distance - distance) <= maxDistance) {
+					stack.push_back(child);
+				}
+			}
+		}
+
+		std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+			return a.distance != b.distance ? a.distance < b.distance : a.id < b.id;
+		});
+	}
+
+	void clear(BKTree& tree) {
+		tree.nodes.clear();
+		tree.ids.clear();
+	}
+}
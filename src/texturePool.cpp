@@ -0,0 +1,122 @@
+#include <algorithm>
+#include "texturePool.h"
+
+TexturePool::TexturePool(int maxFreeTextures) : maxFreeTextures(maxFreeTextures) {
+	immutableStorage = GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage;
+}
+
+TexturePool::~TexturePool() {
+	for (const auto& entry : textureKeys) {
+		glDeleteTextures(1, &entry.first);
+	}
+}
+
+GLuint TexturePool::acquire(glm::ivec2 size, GLenum internalFormat) {
+	TextureKey key{
+		.width = size.x,
+		.height = size.y,
+		.internalFormat = internalFormat
+	};
+
+	auto free = freeTextures.find(key);
+	if (free != freeTextures.end() && !free->second.empty()) {
+		GLuint texture = free->second.back();
+		free->second.pop_back();
+		freeTextureCount--;
+		return texture;
+	}
+
+	return createTexture(key);
+}
+
+void TexturePool::release(GLuint texture) {
+	auto key = textureKeys.find(texture);
+	if (key == textureKeys.end()) return;
+
+	if (freeTextureCount >= maxFreeTextures) {
+		deleteTexture(texture);
+		return;
+	}
+
+	freeTextures[key->second].push_back(texture);
+	freeTextureCount++;
+}
+
+void TexturePool::setMaxFreeTextures(int count) {
+	maxFreeTextures = count;
+	trim();
+}
+
+int TexturePool::getFreeTextureCount() const {
+	return freeTextureCount;
+}
+
+int TexturePool::getTotalTextureCount() const {
+	return static_cast<int>(textureKeys.size());
+}
+
+int TexturePool::getLevelCount(glm::ivec2 size) {
+	int levels = 1;
+	for (int largest = std::max(size.x, size.y); largest > 1; largest >>= 1) {
+		levels++;
+	}
+	return levels;
+}
+
+glm::ivec2 TexturePool::getLevelSize(glm::ivec2 size, int level) {
+	return glm::ivec2(std::max(size.x >> level, 1), std::max(size.y >> level, 1));
+}
+
+GLuint TexturePool::createTexture(const TextureKey& key) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	// Trilinear minification, which only reads levels up to GL_TEXTURE_MAX_LEVEL
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// Clamped so that filtering at the edges doesn't blend in the opposite edge, which is most
+	// visible on subsampled chroma planes.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	const glm::ivec2 size(key.width, key.height);
+	const int levels = getLevelCount(size);
+	if (immutableStorage) {
+		glTexStorage2D(GL_TEXTURE_2D, levels, key.internalFormat, key.width, key.height);
+	} else {
+		// Without immutable storage, allocate each level once with no data. The format and type only need
+		// to be valid for the internal format since no pixels are read.
+		for (int level = 0; level < levels; level++) {
+			const glm::ivec2 levelSize = getLevelSize(size, level);
+			glTexImage2D(GL_TEXTURE_2D, level, key.internalFormat, levelSize.x, levelSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	textureKeys.emplace(texture, key);
+	return texture;
+}
+
+void TexturePool::deleteTexture(GLuint texture) {
+	glDeleteTextures(1, &texture);
+	textureKeys.erase(texture);
+}
+
+void TexturePool::trim() {
+	for (auto i = freeTextures.begin(); i != freeTextures.end() && freeTextureCount > maxFreeTextures;) {
+		std::vector<GLuint>& textures = i->second;
+		while (!textures.empty() && freeTextureCount > maxFreeTextures) {
+			deleteTexture(textures.back());
+			textures.pop_back();
+			freeTextureCount--;
+		}
+
+		if (textures.empty()) {
+			i = freeTextures.erase(i);
+		} else {
+			i++;
+		}
+	}
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <format>
 #include <iostream>
 #include <set>
@@ -10,6 +11,7 @@
 #include "export.h"
 #include "glCommon.h"
 #include "imageView.h"
+#include "orientation.h"
 #include "res/fontFA6.h"
 #include "res/fontOpenSans.h"
 #include "styles.h"
@@ -32,6 +34,12 @@ namespace {
 		bool hideSkippedImages = true;
 		bool exportInProgress = false;
 		bool resetZoomOnChange = true;
+		bool focusPeaking = false;
+		bool showClipping = false;
+		// The loupe shows the same region of every image in the group, centered on this point in
+		// normalized display coordinates
+		bool showLoupe = false;
+		glm::vec2 loupeCenter{ 0.5f, 0.5f };
 
 		// Data used to defer UI updates until after frame is rendered
 		bool openDirectoryPicker = false;
@@ -47,10 +55,21 @@ namespace {
 	UIState uiState;
 
 	std::string bytesToSizeString(unsigned long long bytes);
+	void orientedImage(ImTextureID textureId, ImVec2 size, int orientation);
+
+	// Columns and rows of image panes shown in a view mode
+	glm::ivec2 getImageViewGrid(ViewMode viewMode) {
+		switch (viewMode) {
+		case ViewMode_Double: return glm::ivec2(2, 1);
+		case ViewMode_Grid2x2: return glm::ivec2(2, 2);
+		case ViewMode_Grid3x3: return glm::ivec2(3, 3);
+		default: return glm::ivec2(1, 1);
+		}
+	}
 }
 
-UI::UI(GLFWwindow* window, const Config::Config& config, const std::vector<Group::ImageGroup>& groups, ImageCache* imageCache, Group::GroupParameters& groupParameters, Monitor* monitor)
-	: window(window), config(config), imageTargetSize(glm::ivec2(1, 1)), groups(groups), imageCache(imageCache), groupParameters(groupParameters), monitor(monitor) {
+UI::UI(GLFWwindow* window, const Config::Config& config, const std::vector<Group::ImageGroup>& groups, const Group::GroupIndex& groupIndex, const Group::GroupingIndex& groupingIndex, ImageCache* imageCache, Group::GroupParameters& groupParameters, Monitor* monitor)
+	: previewImageSize(imageCache->getPreviewTextureSize(PreviewTier_Small)), window(window), config(config), imageTargetSize(glm::ivec2(1, 1)), groups(groups), groupIndex(groupIndex), groupingIndex(groupingIndex), imageCache(imageCache), groupParameters(groupParameters), monitor(monitor) {
 	IMGUI_CHECKVERSION();
     ImGui::CreateContext();
 	ImPlot::CreateContext();
@@ -66,8 +85,12 @@ UI::UI(GLFWwindow* window, const Config::Config& config, const std::vector<Group
 
 	setGlobalStyles();
 
-	imageViewer[0] = new ImageViewer(imageCache->getImages());
-	imageViewer[1] = new ImageViewer(imageCache->getImages());
+	imageViewRenderer = new ImageViewRenderer();
+	for (ImageViewer*& viewer : imageViewer) {
+		viewer = new ImageViewer(imageCache->getImages());
+	}
+	loupe = new Loupe(loupeDecodeThreads);
+	contactSheet = new ContactSheet(*imageCache);
 
 	io.Fonts->AddFontFromMemoryCompressedBase85TTF(OpenSans_compressed_data_base85, 16);
 
@@ -79,8 +102,12 @@ UI::UI(GLFWwindow* window, const Config::Config& config, const std::vector<Group
 }
 
 UI::~UI() {
-	delete imageViewer[0];
-	delete imageViewer[1];
+	for (ImageViewer* viewer : imageViewer) {
+		delete viewer;
+	}
+	delete imageViewRenderer;
+	delete loupe;
+	delete contactSheet;
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImPlot::DestroyContext();
@@ -91,65 +118,45 @@ void UI::inputKey(int key) {
 	if (controlPanelState != ControlPanel_ShowFiles) return;
 
 	if (config.keyToAction.contains(key)) {
+		// Actions on a single image apply to the pane under the cursor, or the only pane. The contact sheet
+		// selects its image in the first pane.
+		const int targetImageView = getImageViewCount() == 1 ? 0 : getHoveredImageView();
 		switch (config.keyToAction.at(key)) {
 		case Config::KeyAction_Next:
-			if (uiState.viewMode == ViewMode_Single) {
-				goToNextUnskippedImage(0);
-			} else if (uiState.viewMode == ViewMode_Double) {
-				if (mouseOverlappingImage(0)) {
-					goToNextUnskippedImage(0);
-				} else if (mouseOverlappingImage(1)) {
-					goToNextUnskippedImage(1);
-				}
+			if (targetImageView != -1) {
+				goToNextUnskippedImage(targetImageView);
 			}
 			break;
 		case Config::KeyAction_Previous:
-			if (uiState.viewMode == ViewMode_Single) {
-				goToPreviousUnskippedImage(0);
-			} else if (uiState.viewMode == ViewMode_Double) {
-				if (mouseOverlappingImage(0)) {
-					goToPreviousUnskippedImage(0);
-				} else if (mouseOverlappingImage(1)) {
-					goToPreviousUnskippedImage(1);
-				}
+			if (targetImageView != -1) {
+				goToPreviousUnskippedImage(targetImageView);
 			}
 			break;
 		case Config::KeyAction_Reset:
-			if (uiState.viewMode == ViewMode_Single || mouseOverlappingImage(0)) {
-				imageViewer[0]->resetTransform();
-				if (uiState.imageViewMovementLocked) {
-					imageViewer[1]->resetTransform();
-				}
-			} else if (mouseOverlappingImage(1)) {
-				imageViewer[1]->resetTransform();
-				if (uiState.imageViewMovementLocked) {
-					imageViewer[0]->resetTransform();
-				}
+			if (targetImageView != -1) {
+				resetImageViews(targetImageView);
 			}
 			break;
 		case Config::KeyAction_Save:
-			if (uiState.viewMode == ViewMode_Single || mouseOverlappingImage(0)) {
-				onSaveImage(selectedImages[0]);
-			} else if (mouseOverlappingImage(1)) {
-				onSaveImage(selectedImages[1]);
+			if (targetImageView != -1 && selectedImages[targetImageView] != -1) {
+				onSaveImage(selectedImages[targetImageView]);
 			}
 			break;
 		case Config::KeyAction_Skip:
-			if (uiState.viewMode == ViewMode_Single || mouseOverlappingImage(0)) {
-				onSkipImage(selectedImages[0]);
-			} else if (mouseOverlappingImage(1)) {
-				onSkipImage(selectedImages[1]);
+			if (targetImageView != -1 && selectedImages[targetImageView] != -1) {
+				toggleSkipImage(selectedImages[targetImageView]);
 			}
 			break;
 		case Config::KeyAction_ToggleHideSkipped:
 			uiState.hideSkippedImages = !uiState.hideSkippedImages;
 			break;
 		case Config::KeyAction_ToggleLockMovement:
-			if (uiState.viewMode == ViewMode_Double) {
+			if (getImageViewCount() > 1) {
 				uiState.imageViewMovementLocked = !uiState.imageViewMovementLocked;
 				if (uiState.imageViewMovementLocked) {
-					imageViewer[0]->resetTransform();
-					imageViewer[1]->resetTransform();
+					for (ImageViewer* viewer : imageViewer) {
+						viewer->resetTransform();
+					}
 				}
 			}
 			break;
@@ -157,6 +164,24 @@ void UI::inputKey(int key) {
 			controlPanelState = ControlPanel_ShowGroups;
 			selectedImages.fill(-1);
 			break;
+		case Config::KeyAction_ToggleFocusPeaking:
+			uiState.focusPeaking = !uiState.focusPeaking;
+			break;
+		case Config::KeyAction_ToggleClipping:
+			uiState.showClipping = !uiState.showClipping;
+			break;
+		case Config::KeyAction_ShowLoupe: {
+			// Centers the loupe on the point under the cursor, or hides it if the cursor isn't over an image
+			int imageView = getHoveredImageView();
+			glm::vec2 position;
+			if (imageView != -1 && imageViewer[imageView]->getImagePosition(glm::vec2(inputState.prevMousePosition), position)) {
+				uiState.showLoupe = true;
+				uiState.loupeCenter = position;
+			} else {
+				uiState.showLoupe = false;
+			}
+			break;
+		}
 		case Config::KeyAction_Count:
 			break;
 		}
@@ -171,16 +196,22 @@ void UI::inputClick(int button, int action, int mods) {
 			double mouseX, mouseY;
 			glfwGetCursorPos(window, &mouseX, &mouseY);
 
-			if (elapsed <= doubleClickSeconds && mouseX == inputState.leftClickStart.x && mouseY == inputState.leftClickStart.y) {
-				if (mouseOverlappingImage(0)) {
-					imageViewer[0]->resetTransform();
-					if (uiState.viewMode == ViewMode_Double && uiState.imageViewMovementLocked) {
-						imageViewer[1]->resetTransform();
-					}
-				} else if (mouseOverlappingImage(1)) {
-					imageViewer[1]->resetTransform();
-					if (uiState.viewMode == ViewMode_Double && uiState.imageViewMovementLocked) {
-						imageViewer[0]->resetTransform();
+			const int hoveredImageView = getHoveredImageView();
+			const bool doubleClick = elapsed <= doubleClickSeconds && mouseX == inputState.leftClickStart.x && mouseY == inputState.leftClickStart.y;
+			if (doubleClick && hoveredImageView != -1) {
+				resetImageViews(hoveredImageView);
+			}
+
+			// Clicking a tile of the contact sheet selects its image, and double clicking opens it in the single view
+			if (uiState.viewMode == ViewMode_ContactSheet && controlPanelState == ControlPanel_ShowFiles) {
+				const int tileImage = contactSheet->getImageAt(glm::vec2(mouseX, mouseY));
+				if (tileImage != -1) {
+					if (doubleClick && tileImage == selectedImages[0]) {
+						uiState.updateViewMode = true;
+						uiState.newViewMode = ViewMode_Single;
+					} else if (tileImage != selectedImages[0]) {
+						selectImage(0, tileImage);
+						uiState.scrollToSelectedFile = true;
 					}
 				}
 			}
@@ -189,19 +220,8 @@ void UI::inputClick(int button, int action, int mods) {
 			inputState.prevMousePosition = glm::ivec2(mouseX, mouseY);
 			inputState.lastClickTime = glfwGetTime();
 
-			bool overlaps[2] = {
-				mouseOverlappingImage(0),
-				mouseOverlappingImage(1)
-			};
-
-			inputState.panningImage = overlaps[0] || overlaps[1];
-			if (overlaps[0]) {
-				inputState.mouseActiveImage = 0;
-			} else if (overlaps[1]) {
-				inputState.mouseActiveImage = 1;
-			} else {
-				inputState.mouseActiveImage = -1;
-			}
+			inputState.panningImage = hoveredImageView != -1;
+			inputState.mouseActiveImage = hoveredImageView;
 		} else if (action == GLFW_RELEASE) {
 			inputState.leftClickDown = false;
 			inputState.panningImage = false;
@@ -215,8 +235,9 @@ void UI::inputMouseMove(double x, double y) {
 		glm::ivec2 dragOffset = glm::ivec2(x, y) - inputState.prevMousePosition;
 		if (inputState.panningImage) {
 			if (uiState.imageViewMovementLocked) {
-				imageViewer[0]->pan(dragOffset);
-				imageViewer[1]->pan(dragOffset);
+				for (int i = 0; i < getImageViewCount(); i++) {
+					imageViewer[i]->pan(dragOffset);
+				}
 			} else {
 				imageViewer[inputState.mouseActiveImage]->pan(dragOffset);
 			}
@@ -226,24 +247,44 @@ void UI::inputMouseMove(double x, double y) {
 }
 
 void UI::inputScroll(int offset) {
-	if (mouseOverlappingImage(0)) {
-		imageViewer[0]->zoom(offset, inputState.prevMousePosition - imageTargetPositions[0]);
-		if (uiState.imageViewMovementLocked) {
-			imageViewer[1]->zoom(offset, inputState.prevMousePosition - imageTargetPositions[0]);
+	// The contact sheet scrolls, or zooms its tiles while control is held
+	if (uiState.viewMode == ViewMode_ContactSheet) {
+		if (controlPanelState == ControlPanel_ShowFiles && mouseOverlappingImage(0)) {
+			if (ImGui::GetIO().KeyCtrl) {
+				contactSheet->zoom(offset, glm::vec2(inputState.prevMousePosition));
+			} else {
+				contactSheet->scroll(offset);
+			}
 		}
-	} else if (mouseOverlappingImage(1)) {
-		imageViewer[1]->zoom(offset, inputState.prevMousePosition - imageTargetPositions[1]);
-		if (uiState.imageViewMovementLocked) {
-			imageViewer[0]->zoom(offset, inputState.prevMousePosition - imageTargetPositions[1]);
+		return;
+	}
+
+	const int hoveredImageView = getHoveredImageView();
+	if (hoveredImageView == -1) return;
+
+	// Linked panes zoom about the same position relative to their own area
+	const glm::ivec2 position = inputState.prevMousePosition - imageTargetPositions[hoveredImageView];
+	for (int i = 0; i < getImageViewCount(); i++) {
+		if (i == hoveredImageView || uiState.imageViewMovementLocked) {
+			imageViewer[i]->zoom(offset, position);
 		}
 	}
 }
 
+bool UI::isAnimating() const {
+	for (int i = 0; i < getImageViewCount(); i++) {
+		if (imageViewer[i]->isAnimating()) return true;
+	}
+	if (uiState.viewMode == ViewMode_ContactSheet && controlPanelState == ControlPanel_ShowFiles && contactSheet->isAnimating()) return true;
+	return false;
+}
+
 void UI::renderFrame(double elapsed) {
-	imageViewer[0]->renderFrame(elapsed, imageTargetSize);
-	if (uiState.viewMode != ViewMode_Single) {
-		imageViewer[1]->renderFrame(elapsed, imageTargetSize);
+	for (int i = 0; i < getImageViewCount(); i++) {
+		imageViewer[i]->update(elapsed);
 	}
+	loupe->frameUpdate();
+	contactSheet->update(elapsed);
 
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -362,10 +403,16 @@ void UI::renderFrame(double elapsed) {
 
 	if (uiState.viewMode == ViewMode_Single) {
 		renderSingleImageView();
-	} else if (uiState.viewMode == ViewMode_Double) {
+	} else if (uiState.viewMode == ViewMode_ContactSheet) {
+		renderContactSheet();
+	} else {
 		renderCompareImageView();
 	}
 
+	if (uiState.showLoupe && controlPanelState == ControlPanel_ShowFiles && uiState.viewMode != ViewMode_ContactSheet) {
+		renderLoupeStrip(glm::vec2(ImGui::GetWindowPos().x, ImGui::GetWindowPos().y + ImGui::GetWindowSize().y), ImGui::GetWindowSize().x);
+	}
+
 	ImGui::EndChild();
 	ImGui::PopStyleVar();
 
@@ -375,6 +422,7 @@ void UI::renderFrame(double elapsed) {
 	if (showStatsWindow) renderStatsWindow();
 	if (showSettingsWindow) renderSettingsWindow();
 	if (showAboutWindow) renderAboutWindow();
+	if (showSimilarImagesWindow) renderSimilarImagesWindow();
 
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -395,18 +443,20 @@ void UI::renderFrame(double elapsed) {
 		uiState.updateViewMode = false;
 		uiState.newViewMode = -1;
 
-		imageViewer[0]->resetTransform();
-		imageViewer[1]->resetTransform();
-
-		if (uiState.viewMode == ViewMode_Single) {
-			// Updated from compare to single, so let left image become the single image automatically.
-			// The right image is deselected.
-			selectedImages[1] = -1;
-		} else if (uiState.viewMode == ViewMode_Double) {
-			// Updated from single to compare, so the single image becomes the left image automatically.
-			// Select the next non-skipped image for the right image.
-			selectImage(1, selectedImages[0]);
-			goToNextUnskippedImage(1);
+		for (ImageViewer* viewer : imageViewer) {
+			viewer->resetTransform();
+		}
+
+		// The first image stays in the first pane. Panes that are no longer shown are deselected, and each
+		// new pane is filled with the next non-skipped image after the pane before it.
+		for (int i = 1; i < maxImageViews; i++) {
+			if (i >= getImageViewCount()) {
+				selectedImages[i] = -1;
+				imageViewer[i]->setImage(-1);
+			} else if (selectedImages[i] == -1) {
+				selectImage(i, selectedImages[i - 1]);
+				goToNextUnskippedImage(i);
+			}
 		}
 	}
 
@@ -418,6 +468,51 @@ void UI::renderFrame(double elapsed) {
 	}
 }
 
+bool UI::renderGroupParameterLabel(const char* label, bool* enabled, const char* tooltip) {
+	ImGui::TableNextRow();
+	ImGui::TableSetColumnIndex(0);
+	bool changed = ImGui::Checkbox(label, enabled);
+
+	ImGui::SameLine();
+	ImGui::PushStyleColor(ImGuiCol_Text, Colors::textHint);
+	ImGui::Text("?");
+	ImGui::PopStyleColor();
+	ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(tooltipPadding, tooltipPadding));
+	ImGui::SetItemTooltip("%s", tooltip);
+	ImGui::PopStyleVar();
+	ImGui::Spacing();
+	return changed;
+}
+
+void UI::renderGroupCountCurve() {
+	// Number of groups at each whole second of the time threshold, each a binary search over the sorted gaps
+	std::vector<double> thresholds(maxGroupTimeSeconds + 1);
+	std::vector<double> counts(maxGroupTimeSeconds + 1);
+	Group::GroupParameters parameters = groupParameters;
+	parameters.timeEnabled = true;
+	for (int seconds = 0; seconds <= maxGroupTimeSeconds; seconds++) {
+		parameters.timeSeconds = seconds;
+		thresholds[seconds] = seconds;
+		counts[seconds] = Group::countGroups(groupingIndex, parameters);
+	}
+
+	if (ImPlot::BeginPlot("##group_count_plot", ImVec2(-1, 80), ImPlotFlags_CanvasOnly | ImPlotFlags_NoInputs | ImPlotFlags_NoChild)) {
+		ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_NoDecorations, ImPlotAxisFlags_NoGridLines | ImPlotAxisFlags_NoLabel);
+		ImPlot::SetupAxesLimits(0.0, maxGroupTimeSeconds, 0.0, counts[0] * 1.1, ImPlotCond_Always);
+		ImPlot::PushStyleColor(ImPlotCol_Line, Colors::greenDark);
+		ImPlot::PlotLine("groups", thresholds.data(), counts.data(), static_cast<int>(counts.size()));
+		ImPlot::PopStyleColor();
+		if (groupParameters.timeEnabled) {
+			double threshold = groupParameters.timeSeconds;
+			ImPlot::PushStyleColor(ImPlotCol_Line, Colors::gray5);
+			ImPlot::PlotInfLines("threshold", &threshold, 1);
+			ImPlot::PopStyleColor();
+		}
+		ImPlot::EndPlot();
+	}
+	ImGui::SetItemTooltip("Number of groups for each time threshold.");
+}
+
 void UI::renderControlPanelGroupOptions() {
 	beginSection("group_parameter_padding_window", controlPadding, controlWidth[uiState.viewMode]);
 
@@ -433,41 +528,68 @@ void UI::renderControlPanelGroupOptions() {
 		ImGui::TableSetupColumn("parameter_checkboxes", ImGuiTableColumnFlags_WidthFixed);
 		ImGui::TableSetupColumn("parameter_controls", ImGuiTableColumnFlags_WidthStretch);
 
-		// Row 0
-		ImGui::TableNextRow();
-		ImGui::TableSetColumnIndex(0);
-		ImGui::Checkbox("Time", &groupParameters.timeEnabled);
-
-		ImGui::SameLine();
-		ImGui::PushStyleColor(ImGuiCol_Text, Colors::textHint);
-		ImGui::Text("?");
-		ImGui::PopStyleColor();
-		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(tooltipPadding, tooltipPadding));
-		ImGui::SetItemTooltip("Maximum seconds between images within the same group.");
-		ImGui::PopStyleVar();
-		ImGui::Spacing();
+		// Any change to the parameters regroups immediately, so the groups list follows the sliders as they move
+		bool parametersChanged = false;
 
+		// Row 0
+		parametersChanged |= renderGroupParameterLabel("Time", &groupParameters.timeEnabled, "Maximum seconds between images within the same group.");
 		ImGui::TableSetColumnIndex(1);
 		ImGui::SetNextItemWidth(-1);
 		if (!groupParameters.timeEnabled) {
 			ImGui::BeginDisabled();
 		}
-		ImGui::SliderInt("##time", &groupParameters.timeSeconds, 0, 60, "%d sec", 0);
+		parametersChanged |= ImGui::SliderInt("##time", &groupParameters.timeSeconds, 0, maxGroupTimeSeconds, "%d sec", 0);
 		if (!groupParameters.timeEnabled) {
 			ImGui::EndDisabled();
 		}
-		if (groupParameters.timeSeconds < 0) {
-			groupParameters.timeSeconds = 0;
-		} else if (groupParameters.timeSeconds > 60) {
-			groupParameters.timeSeconds = 60;
+		groupParameters.timeSeconds = std::clamp(groupParameters.timeSeconds, 0, maxGroupTimeSeconds);
+
+		// Row 1
+		parametersChanged |= renderGroupParameterLabel("Camera", &groupParameters.cameraEnabled, "Start a new group when the camera body changes.");
+
+		// Row 2
+		parametersChanged |= renderGroupParameterLabel("Lens", &groupParameters.lensEnabled, "Start a new group when the lens changes.");
+
+		// Row 3
+		parametersChanged |= renderGroupParameterLabel("Focal length", &groupParameters.focalLengthEnabled, "Minimum change in focal length that starts a new group.");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::SetNextItemWidth(-1);
+		if (!groupParameters.focalLengthEnabled) {
+			ImGui::BeginDisabled();
+		}
+		parametersChanged |= ImGui::SliderInt("##focal_length", &groupParameters.focalLengthMillimeters, 1, 200, "%d mm", 0);
+		if (!groupParameters.focalLengthEnabled) {
+			ImGui::EndDisabled();
+		}
+		groupParameters.focalLengthMillimeters = std::clamp(groupParameters.focalLengthMillimeters, 1, 200);
+
+		// Row 4
+		parametersChanged |= renderGroupParameterLabel("Similarity", &groupParameters.similarityEnabled, "Start a new group when consecutive images look different. Lower values split on smaller changes.");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::SetNextItemWidth(-1);
+		if (!groupParameters.similarityEnabled) {
+			ImGui::BeginDisabled();
+		}
+		parametersChanged |= ImGui::SliderInt("##similarity", &groupParameters.similarityBits, 1, 32, "%d bits", 0);
+		if (!groupParameters.similarityEnabled) {
+			ImGui::EndDisabled();
 		}
+		groupParameters.similarityBits = std::clamp(groupParameters.similarityBits, 1, 32);
 
 		ImGui::EndTable();
 
+		if (parametersChanged && allowGroupInteraction) {
+			onGroupParametersChanged();
+			invalidateFileFilter();
+		}
+
+		renderGroupCountCurve();
+
 		ImGui::Spacing();
 
 		if (ImGui::Button("Regenerate Groups")) {
 			onRegenerateGroups();
+			invalidateFileFilter();
 		}
 		if (!allowGroupInteraction) ImGui::EndDisabled();
 		ImGui::Spacing();
@@ -516,92 +638,115 @@ void UI::renderControlPanelGroupsList() {
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(controlPadding, controlPadding));
 	float groupItemWidth = ImGui::GetContentRegionAvail().x - controlPadding * 2;
 
-	for (int i = 0; i < groups.size(); i++) {
-		if (hoveredChildIndex == i && allowGroupInteraction) {
-			ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray2);
-		}
-
-		ImGui::SetCursorPosX(controlPadding);
-		ImGui::BeginChild(std::format("group_child_{}", i).c_str(), ImVec2(groupItemWidth, 0.0f), ImGuiChildFlags_Borders | ImGuiChildFlags_AutoResizeY);
-		if (ImGui::BeginTable(std::format("group_table_{}", i).c_str(), 2, ImGuiTableFlags_NoBordersInBody)) {
-			// Wrap the call to TableNextRow with zero cell padding to avoid the padding added on top of the row.
-			ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, {0, 0});
-			ImGui::TableNextRow();
-			ImGui::PopStyleVar();
-
-			ImGui::TableSetColumnIndex(0);
-
-			unsigned int textureId = imageCache->getImage(groups[i].ids[0])->previewTextureId;
-			ImGui::Image(textureId, ImVec2(previewImageSize.x, previewImageSize.y), ImVec2(0, 1), ImVec2(1, 0));
-
-			ImGui::TableSetColumnIndex(1);
-			ImGui::Text("Group %d", i + 1);
-			ImGui::Separator();
-			ImGui::Text("%zu image%s", groups[i].ids.size(), groups[i].ids.size() == 1 ? "" : "s");
+	// Only the visible rows are built. Every row has the same height, so the clipper can place them directly.
+	ImGuiListClipper clipper;
+	clipper.Begin(static_cast<int>(groups.size()), listRowHeight());
+	while (clipper.Step()) {
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+			ImGui::PushID(i);
+				if (hoveredChildIndex == i && allowGroupInteraction) {
+					ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray2);
+				}
 
-			if (groups[i].skippedCount == groups[i].ids.size()) {
-				ImGui::Text("All images skipped");
-			} else {
-				bool noSavedImages = groups[i].savedCount == 0;
-				if (noSavedImages) ImGui::PushStyleColor(ImGuiCol_Text, Colors::yellow);
-				ImGui::Text("%d saved, %d skipped", groups[i].savedCount, groups[i].skippedCount);
-				if (noSavedImages) ImGui::PopStyleColor();
-			}
+				ImGui::SetCursorPosX(controlPadding);
+				ImGui::BeginChild("group_child", ImVec2(groupItemWidth, listChildHeight), ImGuiChildFlags_Borders);
+				if (ImGui::BeginTable("group_table", 2, ImGuiTableFlags_NoBordersInBody)) {
+					// Wrap the call to TableNextRow with zero cell padding to avoid the padding added on top of the row.
+					ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, {0, 0});
+					ImGui::TableNextRow();
+					ImGui::PopStyleVar();
+
+					ImGui::TableSetColumnIndex(0);
+
+					const Image* groupImage = imageCache->getImage(groups[i].ids[0]);
+					orientedImage(groupImage->previews[PreviewTier_Small].textureId, ImVec2(previewImageSize.x, previewImageSize.y), groupImage->orientation);
+
+					ImGui::TableSetColumnIndex(1);
+					ImGui::Text("Group %d", i + 1);
+					ImGui::Separator();
+					ImGui::Text("%zu image%s", groups[i].ids.size(), groups[i].ids.size() == 1 ? "" : "s");
+
+					if (groups[i].skippedCount == groups[i].ids.size()) {
+						ImGui::Text("All images skipped");
+					} else {
+						bool noSavedImages = groups[i].savedCount == 0;
+						if (noSavedImages) ImGui::PushStyleColor(ImGuiCol_Text, Colors::yellow);
+						ImGui::Text("%d saved, %d skipped", groups[i].savedCount, groups[i].skippedCount);
+						if (noSavedImages) ImGui::PopStyleColor();
+					}
 
-			ImGui::EndTable();
-		}
-		ImGui::EndChild();
+					ImGui::EndTable();
+				}
+				ImGui::EndChild();
 
-		// Group right click popup
-		ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray1);
-		if (ImGui::BeginPopupContextItem()) {
-			ImGui::BeginChild(std::format("group popup {}", i).c_str(), ImVec2(rightClickMenuWidth, 0), ImGuiChildFlags_AutoResizeY);
-			ImGui::TextWrapped("Group %d", i + 1);
-			ImGui::Separator();
-			if (ImGui::Selectable("Save all images")) {
-				onSaveGroup(i);
-				ImGui::CloseCurrentPopup();
-			}
-			if (ImGui::Selectable("Skip all images")) {
-				onSkipGroup(i);
-				ImGui::CloseCurrentPopup();
-			}
-			if (ImGui::Selectable("Reset all images")) {
-				onResetGroup(i);
-				ImGui::CloseCurrentPopup();
-			}
-			ImGui::EndChild();
-			ImGui::EndPopup();
-		}
-		ImGui::PopStyleColor();
+				// Group right click popup
+				ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray1);
+				if (ImGui::BeginPopupContextItem()) {
+					ImGui::BeginChild("group popup", ImVec2(rightClickMenuWidth, 0), ImGuiChildFlags_AutoResizeY);
+					ImGui::TextWrapped("Group %d", i + 1);
+					ImGui::Separator();
+					if (ImGui::Selectable("Save all images")) {
+						onSaveGroup(i);
+						ImGui::CloseCurrentPopup();
+					}
+					if (ImGui::Selectable("Skip all images")) {
+						onSkipGroup(i);
+						invalidateFileFilter();
+						ImGui::CloseCurrentPopup();
+					}
+					if (ImGui::Selectable("Reset all images")) {
+						onResetGroup(i);
+						invalidateFileFilter();
+						ImGui::CloseCurrentPopup();
+					}
+					ImGui::Separator();
+					if (ImGui::Selectable("Sort by sharpness")) {
+						onSortGroup(i, Group::GroupSort_Sharpness);
+						invalidateFileFilter();
+						ImGui::CloseCurrentPopup();
+					}
+					if (ImGui::Selectable("Sort by filename")) {
+						onSortGroup(i, Group::GroupSort_Filename);
+						invalidateFileFilter();
+						ImGui::CloseCurrentPopup();
+					}
+					ImGui::EndChild();
+					ImGui::EndPopup();
+				}
+				ImGui::PopStyleColor();
 
-		ImGui::Spacing();
+				ImGui::Spacing();
 
-		if (allowGroupInteraction) {
-			if (hoveredChildIndex == i) {
-				ImGui::PopStyleColor();
-			}
+				if (allowGroupInteraction) {
+					if (hoveredChildIndex == i) {
+						ImGui::PopStyleColor();
+					}
 
-			if (ImGui::IsItemHovered()) {
-				ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
-				hoveredChildIndex = i;
-				anyChildHovered = true;
-			}
+					if (ImGui::IsItemHovered()) {
+						ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
+						hoveredChildIndex = i;
+						anyChildHovered = true;
+					}
 
-			if (ImGui::IsItemClicked()) {
-				controlPanelState = ControlPanel_ShowFiles;
-				uiState.viewMode = ViewMode_Single;
-				selectedGroup = i;
-				onGroupSelected(selectedGroup);
-
-				// Select first non-skipped image
-				int firstID = groups.at(selectedGroup).ids.at(0);
-				selectImage(0, firstID);
-				selectImage(1, -1);
-				skippedImage();
-			}
+					if (ImGui::IsItemClicked()) {
+						controlPanelState = ControlPanel_ShowFiles;
+						uiState.viewMode = ViewMode_Single;
+						selectedGroup = i;
+						onGroupSelected(selectedGroup);
+
+						// Select first non-skipped image
+						int firstID = groups.at(selectedGroup).ids.at(0);
+						selectImage(0, firstID);
+						for (int imageView = 1; imageView < maxImageViews; imageView++) {
+							selectImage(imageView, -1);
+						}
+						skippedImage();
+					}
+				}
+			ImGui::PopID();
 		}
 	}
+	clipper.End();
 
 	ImGui::PopStyleVar();
 	ImGui::EndChild();
@@ -631,11 +776,11 @@ void UI::renderControlPanelFiles() {
 	if (ImGui::CollapsingHeader("Options")) {
 		ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, previousWindowPadding);
 
-		const char* viewingModes[] = { "Single", "Side by Side" };
+		const char* viewingModes[ViewMode_Count] = { "Single", "Side by Side", "2x2 Grid", "3x3 Grid", "Contact Sheet" };
 
 		ImGui::SetNextItemWidth(viewModeComboWidth);
 		if (ImGui::BeginCombo("##viewing_mode", viewingModes[(int)uiState.viewMode], 0)) {
-			for (int i = 0; i < 2; i++) {
+			for (int i = 0; i < ViewMode_Count; i++) {
 				const bool selected = i == static_cast<int>(uiState.viewMode);
 				if (ImGui::Selectable(viewingModes[i], selected)) {
 					if (uiState.viewMode != i) {
@@ -653,22 +798,28 @@ void UI::renderControlPanelFiles() {
 
 		ImGui::Checkbox("Hide skipped images", &uiState.hideSkippedImages);
 
-		if (uiState.viewMode == ViewMode_Single) {
+		const bool singleImageView = getImageViewCount() == 1;
+		if (singleImageView) {
 			ImGui::BeginDisabled();
 		}
 
 		if (ImGui::Checkbox("Lock movement", &uiState.imageViewMovementLocked)) {
 			if (uiState.imageViewMovementLocked) {
-				imageViewer[0]->resetTransform();
-				imageViewer[1]->resetTransform();
+				for (ImageViewer* viewer : imageViewer) {
+					viewer->resetTransform();
+				}
 			}
 		}
 
-		if (uiState.viewMode == ViewMode_Single) {
+		if (singleImageView) {
 			ImGui::EndDisabled();
 		}
 
 		ImGui::Checkbox("Reset zoom on change", &uiState.resetZoomOnChange);
+		ImGui::Checkbox("Focus peaking", &uiState.focusPeaking);
+		ImGui::Checkbox("Show clipping", &uiState.showClipping);
+		ImGui::Checkbox("Loupe", &uiState.showLoupe);
+		ImGui::SetItemTooltip("Shows the same 1:1 region of every image. Press Z over an image to center it on the cursor.");
 
 		ImGui::PopStyleVar();
 	}
@@ -701,140 +852,171 @@ void UI::renderControlPanelFiles() {
 
 	ImGui::BeginChild("files_scroll_window", ImVec2(-1, -1), 0, 0);
 	const float fileItemWidth = ImGui::GetContentRegionAvail().x - controlPadding * 2;
-	for (int imageID : groups[selectedGroup].ids) {
-		const Image* image = imageCache->getImage(imageID);
-
-		if (image->skipped && uiState.hideSkippedImages) continue;
-
-		bool setChildBackgroundColor = false;
-		if (imageID == selectedImages[0] || imageID == selectedImages[1]) {
-			ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray3);
-			setChildBackgroundColor = true;
-		} else if (imageID == hoveredChildIndex) {
-			ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray2);
-			setChildBackgroundColor = true;
-		}
-
-		ImGui::SetCursorPosX(controlPadding);
-		ImGui::BeginChild(std::format("file_child_{}", imageID).c_str(), ImVec2(fileItemWidth, 0.0f), ImGuiChildFlags_Borders | ImGuiChildFlags_AutoResizeY);
-		if (ImGui::BeginTable(std::format("file_table_{}", imageID).c_str(), 3, ImGuiTableFlags_NoBordersInBody)) {
-			ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, {0, 0});
-			ImGui::TableNextRow();
-			ImGui::PopStyleVar();
-
-			const float rowWidth = ImGui::GetContentRegionAvail().x;
-
-			ImGui::TableSetColumnIndex(0);
-			// TODO: choose texture id based on image status. completed image is the preview texture,
-			//	loading image is some loading texture, failed is some error texture
-			ImGui::Image(image->previewTextureId, ImVec2(previewImageSize.x, previewImageSize.y), ImVec2(0, 1), ImVec2(1, 0));
-
-			ImGui::TableSetColumnIndex(1);
+	updateFileFilter();
+	const float rowHeight = listRowHeight();
+	if (uiState.scrollToSelectedFile) {
+		auto selectedRow = std::find(fileFilter.ids.begin(), fileFilter.ids.end(), selectedImages[0]);
+		if (selectedRow != fileFilter.ids.end()) {
+			uiState.scrollToSelectedFile = false;
 
-			bool setTextColorDisabled = false;
-			if (image->saved) {
-				ImGui::PushStyleColor(ImGuiCol_Text, Colors::green);
-			} else if (image->skipped && imageID != selectedImages[0] && imageID != selectedImages[1]) {
-				ImGui::PushStyleColor(ImGuiCol_Text, Colors::textDisabled);
-				setTextColorDisabled = true;
+			// Rows outside the clipper aren't submitted, so scroll by position instead of to the item
+			const float rowTop = ImGui::GetCursorPosY() + (selectedRow - fileFilter.ids.begin()) * rowHeight;
+			const float scrollY = ImGui::GetScrollY();
+			const float viewHeight = ImGui::GetWindowHeight();
+			if (rowTop < scrollY) {
+				ImGui::SetScrollY(rowTop);
+			} else if (rowTop + rowHeight > scrollY + viewHeight) {
+				ImGui::SetScrollY(rowTop + rowHeight - viewHeight);
 			}
+		}
+	}
 
-			ImGui::Text("%s", image->shortFilename.c_str());
-
-			if (image->saved) {
-				ImGui::PopStyleColor();
+	ImGuiListClipper clipper;
+	clipper.Begin(static_cast<int>(fileFilter.ids.size()), rowHeight);
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const int imageID = fileFilter.ids[row];
+			const Image* image = imageCache->getImage(imageID);
+			ImGui::PushID(imageID);
+
+			bool setChildBackgroundColor = false;
+			if (isImageShown(imageID)) {
+				ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray3);
+				setChildBackgroundColor = true;
+			} else if (imageID == hoveredChildIndex) {
+				ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray2);
+				setChildBackgroundColor = true;
 			}
 
-			ImGui::Separator();
-			ImGui::Text("%s, %d x %d", bytesToSizeString(image->filesize).c_str(), image->size.x, image->size.y);
+			ImGui::SetCursorPosX(controlPadding);
+			ImGui::BeginChild("file_child", ImVec2(fileItemWidth, listChildHeight), ImGuiChildFlags_Borders);
+			if (ImGui::BeginTable("file_table", 3, ImGuiTableFlags_NoBordersInBody)) {
+				ImGui::PushStyleVar(ImGuiStyleVar_CellPadding, {0, 0});
+				ImGui::TableNextRow();
+				ImGui::PopStyleVar();
 
-			if (image->metadata.timestamp.has_value()) {
-				ImageTimestamp t = image->metadata.timestamp.value();
-				ImGui::Text("%s", std::format("{}:{:0>2} {}/{}/{}", t.hour, t.minute, t.month, t.day, t.year).c_str());
-			} else {
-				ImGui::Text("Date unknown");
-			}
+				const float rowWidth = ImGui::GetContentRegionAvail().x;
 
-			if (setTextColorDisabled) {
-				ImGui::PopStyleColor();
-			}
+				ImGui::TableSetColumnIndex(0);
+				// TODO: choose texture id based on image status. completed image is the preview texture,
+				//	loading image is some loading texture, failed is some error texture
+				orientedImage(image->previews[PreviewTier_Small].textureId, ImVec2(previewImageSize.x, previewImageSize.y), image->orientation);
 
-			if (uiState.viewMode == ViewMode_Double && (imageID == hoveredChildIndex || imageID == selectedImages[0] || imageID == selectedImages[1])) {
-				const float xOffset = rowWidth - compareButtonSize.x * 2 - compareButtonSpacing;
-				const float yOffset = controlPadding + (previewImageSize.x / 2.0f) - (compareButtonSize.y / 2.0f);
+				ImGui::TableSetColumnIndex(1);
 
-				ImGui::TableSetColumnIndex(2);
+				bool setTextColorDisabled = false;
+				if (image->saved) {
+					ImGui::PushStyleColor(ImGuiCol_Text, Colors::green);
+				} else if (image->skipped && !isImageShown(imageID)) {
+					ImGui::PushStyleColor(ImGuiCol_Text, Colors::textDisabled);
+					setTextColorDisabled = true;
+				}
 
-				ImGui::SetCursorPosX(xOffset);
-				ImGui::SetCursorPosY(yOffset);
+				ImGui::Text("%s", image->shortFilename.c_str());
 
-				const bool leftSelected = imageID == selectedImages[0];
-				const bool rightSelected = imageID == selectedImages[1];
+				if (image->saved) {
+					ImGui::PopStyleColor();
+				}
 
-				if (leftSelected) ImGui::PushStyleColor(ImGuiCol_Button, Colors::green);
-				else ImGui::PushStyleColor(ImGuiCol_Button, Colors::gray4);
-				if (ImGui::Button(std::format("##leftCompare").c_str(), ImVec2(compareButtonSize.x, compareButtonSize.y))) {
-					selectImage(0, imageID);
+				if (imageID == fileFilter.sharpestID && groups[selectedGroup].ids.size() > 1) {
+					ImGui::SameLine();
+					ImGui::PushStyleColor(ImGuiCol_Text, Colors::green);
+					ImGui::Text("Sharpest");
+					ImGui::PopStyleColor();
+					ImGui::SetItemTooltip("Highest sharpness in this group.");
 				}
-				ImGui::PopStyleColor();
 
-				ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, { compareButtonSpacing, 0});
-				ImGui::SameLine();
-				ImGui::PopStyleVar();
+				ImGui::Separator();
+				const FileLabels& labels = getFileLabels(*image);
+				ImGui::TextUnformatted(labels.details.c_str());
+				ImGui::TextUnformatted(labels.date.c_str());
 
-				if (rightSelected) ImGui::PushStyleColor(ImGuiCol_Button, Colors::green);
-				else ImGui::PushStyleColor(ImGuiCol_Button, Colors::gray4);
-				if (ImGui::Button(std::format("##rightCompare").c_str(), ImVec2(compareButtonSize.x, compareButtonSize.y))) {
-					selectImage(1, imageID);
+				if (setTextColorDisabled) {
+					ImGui::PopStyleColor();
 				}
-				ImGui::PopStyleColor();
-			}
-
-			ImGui::EndTable();
-		}
 
-		ImGui::EndChild();
+				if (getImageViewCount() > 1 && (imageID == hoveredChildIndex || isImageShown(imageID))) {
+					// One button per pane, laid out like the panes, which shows the image in that pane
+					const glm::ivec2 grid = getImageViewGrid(uiState.viewMode);
+					const ImVec2 buttonSize(
+						compareButtonSize.x,
+						std::min(compareButtonSize.y, (previewImageSize.y - compareButtonSpacing * (grid.y - 1)) / grid.y));
+					const float xOffset = rowWidth - buttonSize.x * grid.x - compareButtonSpacing * (grid.x - 1);
+					const float yOffset = controlPadding + (previewImageSize.y / 2.0f) - (buttonSize.y * grid.y + compareButtonSpacing * (grid.y - 1)) / 2.0f;
+
+					ImGui::TableSetColumnIndex(2);
+					ImGui::SetCursorPosY(yOffset);
+					ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, { compareButtonSpacing, compareButtonSpacing });
+					for (int imageView = 0; imageView < getImageViewCount(); imageView++) {
+						if (imageView % grid.x == 0) {
+							ImGui::SetCursorPosX(xOffset);
+						} else {
+							ImGui::SameLine();
+						}
+
+						ImGui::PushID(imageView);
+						if (imageID == selectedImages[imageView]) ImGui::PushStyleColor(ImGuiCol_Button, Colors::green);
+						else ImGui::PushStyleColor(ImGuiCol_Button, Colors::gray4);
+						if (ImGui::Button("##compare", buttonSize)) {
+							selectImage(imageView, imageID);
+						}
+						ImGui::PopStyleColor();
+						ImGui::PopID();
+					}
+					ImGui::PopStyleVar();
+				}
 
-		// File right click popup
-		ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray1);
-		if (ImGui::BeginPopupContextItem()) {
-			ImGui::BeginChild(std::format("file popup {}", imageID).c_str(), ImVec2(rightClickMenuWidth, 0), ImGuiChildFlags_AutoResizeY);
-			ImGui::TextWrapped("%s", image->filename.c_str());
-			ImGui::Separator();
-			if (ImGui::Selectable(image->saved ? "Undo save" : "Save")) {
-				onSaveImage(imageID);
-				ImGui::CloseCurrentPopup();
-			}
-			if (ImGui::Selectable(image->skipped ? "Undo skip" : "Skip")) {
-				onSkipImage(imageID);
-				ImGui::CloseCurrentPopup();
+				ImGui::EndTable();
 			}
+
 			ImGui::EndChild();
-			ImGui::EndPopup();
-		}
-		ImGui::PopStyleColor();
 
-		ImGui::Spacing();
+			// File right click popup
+			ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray1);
+			if (ImGui::BeginPopupContextItem()) {
+				ImGui::BeginChild("file popup", ImVec2(rightClickMenuWidth, 0), ImGuiChildFlags_AutoResizeY);
+				ImGui::TextWrapped("%s", image->filename.c_str());
+				ImGui::Separator();
+				if (ImGui::Selectable(image->saved ? "Undo save" : "Save")) {
+					onSaveImage(imageID);
+					ImGui::CloseCurrentPopup();
+				}
+				if (ImGui::Selectable(image->skipped ? "Undo skip" : "Skip")) {
+					toggleSkipImage(imageID);
+					ImGui::CloseCurrentPopup();
+				}
+				if (!image->hasDifferenceHash) ImGui::BeginDisabled();
+				if (ImGui::Selectable("Find similar images")) {
+					similarImagesSourceID = imageID;
+					imageCache->findSimilarImages(imageID, similarImagesMaxDistance, similarImages);
+					showSimilarImagesWindow = true;
+					ImGui::CloseCurrentPopup();
+				}
+				if (!image->hasDifferenceHash) ImGui::EndDisabled();
+				ImGui::EndChild();
+				ImGui::EndPopup();
+			}
+			ImGui::PopStyleColor();
 
-		if (uiState.scrollToSelectedFile && imageID == selectedImages[0]) {
-			uiState.scrollToSelectedFile = false;
-			ImGui::ScrollToItem();
-		}
+			ImGui::Spacing();
 
-		if (setChildBackgroundColor) {
-			ImGui::PopStyleColor();
-		}
+			if (setChildBackgroundColor) {
+				ImGui::PopStyleColor();
+			}
 
-		if (ImGui::IsItemHovered(ImGuiHoveredFlags_RectOnly)) {
-			ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
-			hoveredChildIndex = imageID;
-			anyChildHovered = true;
-		}
+			if (ImGui::IsItemHovered(ImGuiHoveredFlags_RectOnly)) {
+				ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
+				hoveredChildIndex = imageID;
+				anyChildHovered = true;
+			}
 
-		if (ImGui::IsItemClicked() && uiState.viewMode == ViewMode_Single) {
-			selectImage(0, imageID);
+			if (ImGui::IsItemClicked() && getImageViewCount() == 1) {
+				selectImage(0, imageID);
+			}
+			ImGui::PopID();
 		}
 	}
+	clipper.End();
 
 	if (!anyChildHovered) {
 		hoveredChildIndex = -1;
@@ -930,7 +1112,11 @@ void UI::renderSingleImageView() {
 	imageTargetPositions[0].x = (int)ImGui::GetWindowPos().x;
 	imageTargetPositions[0].y = (int)ImGui::GetWindowPos().y;
 
-	ImGui::Image(imageViewer[0]->getTextureId(), ImGui::GetContentRegionAvail(), ImVec2(0, 1), ImVec2(1, 0));
+	ImVec2 size = ImGui::GetContentRegionAvail();
+	imageViewer[0]->setOverlays(uiState.focusPeaking, uiState.showClipping);
+	imageViewer[0]->setTarget(glm::vec2(ImGui::GetCursorScreenPos().x, ImGui::GetCursorScreenPos().y), glm::vec2(size.x, size.y));
+	imageViewRenderer->draw(ImGui::GetWindowDrawList(), { imageViewer[0] });
+	ImGui::Dummy(size);
 
 	bool showControls =
 		controlPanelState == ControlPanel_ShowFiles &&
@@ -950,39 +1136,55 @@ void UI::renderSingleImageView() {
 }
 
 void UI::renderCompareImageView() {
-	imageTargetSize.x = static_cast<int>(ImGui::GetContentRegionAvail().x / 2.0f);
-	imageTargetSize.y = (int)ImGui::GetContentRegionAvail().y;
-	imageTargetPositions[0].x = (int)ImGui::GetWindowPos().x;
-	imageTargetPositions[0].y = (int)ImGui::GetWindowPos().y;
-	imageTargetPositions[1].x = (int)ImGui::GetWindowPos().x + imageTargetSize.x;
-	imageTargetPositions[1].y = (int)ImGui::GetWindowPos().y;
-
-	ImVec2 halfSize = ImVec2(ImGui::GetContentRegionAvail().x / 2.0f, ImGui::GetContentRegionAvail().y);
-
-	ImGui::PushStyleVarX(ImGuiStyleVar_ItemSpacing, 0);
-	ImGui::Image(imageViewer[0]->getTextureId(), halfSize, ImVec2(0, 1), ImVec2(1, 0));
-	ImGui::SameLine();
-	ImGui::Image(imageViewer[1]->getTextureId(), halfSize, ImVec2(0, 1), ImVec2(1, 0));
-	ImGui::PopStyleVar();
+	const glm::ivec2 grid = getImageViewGrid(uiState.viewMode);
+	const ImVec2 available = ImGui::GetContentRegionAvail();
+	const glm::vec2 paneSize(available.x / grid.x, available.y / grid.y);
+	const glm::vec2 origin(ImGui::GetCursorScreenPos().x, ImGui::GetCursorScreenPos().y);
+	imageTargetSize = glm::ivec2(paneSize);
+
+	// Panes are filled row by row, and all of them are drawn by one callback
+	std::vector<ImageViewer*> views;
+	for (int i = 0; i < getImageViewCount(); i++) {
+		const glm::vec2 position = origin + glm::vec2(i % grid.x, i / grid.x) * paneSize;
+		imageTargetPositions[i] = glm::ivec2(position);
+		imageViewer[i]->setOverlays(uiState.focusPeaking, uiState.showClipping);
+		imageViewer[i]->setTarget(position, paneSize);
+		views.push_back(imageViewer[i]);
+	}
+	imageViewRenderer->draw(ImGui::GetWindowDrawList(), views);
+	ImGui::Dummy(available);
 
 	// Render the overlay only for the image view overlapping the cursor
-	bool leftImageHovered = mouseOverlappingImage(0);
-	bool rightImageHovered = mouseOverlappingImage(1);
-
-	if (controlPanelState == ControlPanel_ShowFiles && selectedImages[0] != -1 && leftImageHovered) {
+	const int hoveredImageView = getHoveredImageView();
+	if (controlPanelState == ControlPanel_ShowFiles && hoveredImageView != -1 && selectedImages[hoveredImageView] != -1) {
 		const float topMargin = 10;
 		glm::vec2 position{
-			imageTargetPositions[0].x + (imageTargetSize.x / 2),
-			imageTargetPositions[0].y + topMargin
+			static_cast<float>(imageTargetPositions[hoveredImageView].x + imageTargetSize.x / 2),
+			static_cast<float>(imageTargetPositions[hoveredImageView].y) + topMargin
 		};
-		renderImageViewOverlay(0, position);
-	} else if (controlPanelState == ControlPanel_ShowFiles && selectedImages[1] != -1 && rightImageHovered) {
-		const float topMargin = 10;
-		glm::vec2 position{
-			imageTargetPositions[1].x + (imageTargetSize.x / 2),
-			imageTargetPositions[1].y + topMargin
-		};
-		renderImageViewOverlay(1, position);
+		renderImageViewOverlay(hoveredImageView, position);
+	}
+}
+
+void UI::renderContactSheet() {
+	// The sheet takes the place of the first image view, so the cursor checks for that view cover it
+	const ImVec2 available = ImGui::GetContentRegionAvail();
+	const glm::vec2 origin(ImGui::GetCursorScreenPos().x, ImGui::GetCursorScreenPos().y);
+	imageTargetSize = glm::ivec2(available.x, available.y);
+	imageTargetPositions[0] = glm::ivec2(origin);
+
+	static const std::vector<int> noImages;
+	const bool showFiles = controlPanelState == ControlPanel_ShowFiles;
+	const glm::vec2 mousePosition(inputState.prevMousePosition);
+	const int hoveredID = showFiles && ImGui::IsWindowHovered() ? contactSheet->getImageAt(mousePosition) : -1;
+
+	contactSheet->layout(origin, glm::vec2(available.x, available.y), showFiles ? fileFilter.ids : noImages, selectedImages[0], hoveredID);
+	contactSheet->draw(ImGui::GetWindowDrawList());
+	ImGui::Dummy(available);
+
+	if (hoveredID != -1) {
+		const Image* image = imageCache->getImage(hoveredID);
+		ImGui::SetTooltip("%s", image->filename.c_str());
 	}
 }
 
@@ -1020,19 +1222,14 @@ void UI::renderImageViewOverlay(int imageView, glm::vec2 position) {
 
 	if (imageSkipped) ImGui::PushStyleColor(ImGuiCol_Button, Colors::green);
 	if (ImGui::Button("Skip", buttonSize)) {
-		onSkipImage(id);
+		toggleSkipImage(id);
 	}
 	if (ImGui::IsItemHovered()) ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
 	if (imageSkipped) ImGui::PopStyleColor();
 
 	ImGui::SameLine();
 	if (ImGui::Button(ICON_RESIZE, buttonSize)) {
-		if (uiState.imageViewMovementLocked) {
-			imageViewer[0]->resetTransform();
-			imageViewer[1]->resetTransform();
-		} else {
-			imageViewer[imageView]->resetTransform();
-		}
+		resetImageViews(imageView);
 	}
 	if (ImGui::IsItemHovered()) ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
 
@@ -1042,6 +1239,97 @@ void UI::renderImageViewOverlay(int imageView, glm::vec2 position) {
 	ImGui::EndChild();
 }
 
+void UI::renderLoupeStrip(glm::vec2 position, float width) {
+	const std::vector<int>& ids = fileFilter.ids;
+
+	// Crops are drawn at one screen pixel per image pixel
+	const ImVec2 cropSize(static_cast<float>(Loupe::cropSize), static_cast<float>(Loupe::cropSize));
+	const float labelHeight = ImGui::GetTextLineHeightWithSpacing();
+	const ImVec2 stripSize(width, cropSize.y + labelHeight * 2 + controlPadding * 2 + ImGui::GetStyle().ScrollbarSize);
+
+	ImGui::SetNextWindowPos(ImVec2(position.x, position.y - stripSize.y));
+	ImGui::PushStyleColor(ImGuiCol_ChildBg, Colors::gray1);
+	ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(controlPadding, controlPadding));
+	ImGui::BeginChild("loupe_strip", stripSize, ImGuiChildFlags_AlwaysUseWindowPadding, ImGuiWindowFlags_HorizontalScrollbar);
+
+	/*
+	Groups can hold thousands of images, so crops have a fixed width and only the visible ones, plus a
+	small margin for scrolling, are laid out and requested from the loupe.
+	*/
+	const float spacing = ImGui::GetStyle().ItemSpacing.x;
+	const float pitch = cropSize.x + spacing;
+	const int count = static_cast<int>(ids.size());
+	const float scrollX = ImGui::GetScrollX();
+	const int first = std::max(static_cast<int>(scrollX / pitch) - loupeStripMargin, 0);
+	const int last = std::min(static_cast<int>((scrollX + stripSize.x) / pitch) + 1 + loupeStripMargin, count);
+
+	std::vector<const Image*> images;
+	images.reserve(std::max(last - first, 0));
+	for (int i = first; i < last; i++) {
+		images.push_back(imageCache->getImage(ids[i]));
+	}
+	loupe->setRegion(images, uiState.loupeCenter);
+
+	ImGui::PushStyleColor(ImGuiCol_Text, Colors::textHint);
+	const int pendingCount = loupe->getPendingCount();
+	if (pendingCount > 0) {
+		ImGui::Text("Loupe, decoding %d of %zu", pendingCount, images.size());
+	} else {
+		ImGui::Text("Loupe");
+	}
+	ImGui::PopStyleColor();
+
+	const ImVec2 stripStart = ImGui::GetCursorPos();
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	for (int i = first; i < last; i++) {
+		const int id = ids[i];
+		const Image* image = images[i - first];
+		ImGui::SetCursorPos(ImVec2(stripStart.x + i * pitch, stripStart.y));
+		ImGui::PushID(id);
+		ImGui::BeginGroup();
+
+		const ImVec2 cropPosition = ImGui::GetCursorScreenPos();
+		const GLuint texture = loupe->getTexture(id);
+		if (texture != 0) {
+			orientedImage(texture, cropSize, image->orientation);
+		} else {
+			ImGui::Dummy(cropSize);
+			const char* status = loupe->failed(id) ? "Unavailable" : "Decoding...";
+			drawList->AddText(ImVec2(cropPosition.x + controlPadding, cropPosition.y + controlPadding), ImGui::GetColorU32(Colors::textHint), status);
+		}
+		if (isImageShown(id)) {
+			drawList->AddRect(cropPosition, ImVec2(cropPosition.x + cropSize.x, cropPosition.y + cropSize.y), ImGui::GetColorU32(Colors::green), 0.0f, 0, 2.0f);
+		}
+
+		// The file name is clipped to the crop width to keep the pitch fixed
+		const ImVec2 labelPosition = ImGui::GetCursorScreenPos();
+		ImGui::Dummy(ImVec2(cropSize.x, labelHeight));
+		drawList->PushClipRect(labelPosition, ImVec2(labelPosition.x + cropSize.x, labelPosition.y + labelHeight), true);
+		drawList->AddText(labelPosition, ImGui::GetColorU32(image->skipped ? Colors::textDisabled : (image->saved ? Colors::green : Colors::text)), image->shortFilename.c_str());
+		drawList->PopClipRect();
+		ImGui::EndGroup();
+
+		if (ImGui::IsItemHovered()) {
+			ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
+		}
+		if (ImGui::IsItemClicked()) {
+			selectImage(0, id);
+			uiState.scrollToSelectedFile = true;
+		}
+		ImGui::PopID();
+	}
+
+	// Extends the scroll range over the crops that aren't laid out
+	if (count > 0) {
+		ImGui::SetCursorPos(ImVec2(stripStart.x + count * pitch - spacing, stripStart.y));
+		ImGui::Dummy(ImVec2(0.0f, cropSize.y + labelHeight));
+	}
+
+	ImGui::EndChild();
+	ImGui::PopStyleVar();
+	ImGui::PopStyleColor();
+}
+
 void UI::renderPreviewProgress() {
 	ImGui::PushStyleColor(ImGuiCol_Text, Colors::textHint);
 	ImGui::Text("Loading image information");
@@ -1137,7 +1425,13 @@ void UI::renderStatsWindow() {
 		ImGui::TableSetColumnIndex(0);
 		ImGui::Text("Dimensions");
 		ImGui::TableSetColumnIndex(1);
-		ImGui::Text("%d x %d pixels", cacheData.previewTextureSize.x, cacheData.previewTextureSize.y);
+		std::string dimensions;
+		for (int tier = 0; tier < PreviewTier_Count; tier++) {
+			if ((cacheData.residentPreviewTiers & (1 << tier)) == 0) continue;
+			if (!dimensions.empty()) dimensions += ", ";
+			dimensions += std::format("{} x {}", cacheData.previewTextureSizes[tier].x, cacheData.previewTextureSizes[tier].y);
+		}
+		ImGui::Text("%s pixels", dimensions.c_str());
 		ImGui::TableNextRow();
 		ImGui::TableSetColumnIndex(0);
 		ImGui::Text("Estimated size");
@@ -1165,11 +1459,47 @@ void UI::renderStatsWindow() {
 		ImGui::Text("Estimated size");
 		ImGui::TableSetColumnIndex(1);
 		ImGui::Text("%s", bytesToSizeString(cacheData.estimatedFullTextureBytes).c_str());
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Pooled textures");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%d (%d free)", cacheData.pooledTextureCount, cacheData.freePooledTextureCount);
 		ImGui::EndTable();
 
 		ImGui::Unindent();
 	}
 
+	if (ImGui::CollapsingHeader("Decode Buffers")) {
+		const Arena::ArenaStats& arenaStats = cacheData.decodeArenaStats;
+		ImGui::BeginTable("decode_buffers_table", 2, 0, ImVec2(250, 0));
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Allocations");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%llu", arenaStats.allocations);
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Reused buffers");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%llu", arenaStats.reusedAllocations);
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("System allocations");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%llu", arenaStats.systemAllocations);
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Huge page blocks");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%llu", arenaStats.hugePageAllocations);
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Reserved size");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::Text("%s", bytesToSizeString(arenaStats.reservedBytes).c_str());
+		ImGui::EndTable();
+	}
+
 	if (ImGui::CollapsingHeader("Queues")) {
 		ImGui::BeginTable("queues_table", 2, 0, ImVec2(325, 0));
 
@@ -1179,7 +1509,8 @@ void UI::renderStatsWindow() {
 			"Image Queue Threads",
 			"Image Queue Size",
 			"Texture Queue Size",
-			"Pending PBO Map Size"
+			"Pending PBO Map Size",
+			"Preview Batches In Flight"
 		};
 
 		const int rowValues[] = {
@@ -1188,10 +1519,11 @@ void UI::renderStatsWindow() {
 			cacheData.imageLoadingThreads,
 			cacheData.imageQueueSize,
 			cacheData.textureQueueSize,
-			cacheData.pendingPBOSize
+			cacheData.pendingPBOSize,
+			cacheData.previewBatchesInFlight
 		};
 
-		for (int i = 0; i < 6; i++) {
+		for (int i = 0; i < 7; i++) {
 			ImGui::TableNextRow();
 			ImGui::TableSetColumnIndex(0);
 			ImGui::Text("%s", rowLabels[i]);
@@ -1232,6 +1564,7 @@ void UI::renderSettingsWindow() {
 		tempConfig.cacheCapacity = config.cacheCapacity;
 		tempConfig.cacheForwardPreload = config.cacheForwardPreload;
 		tempConfig.cacheBackwardPreload = config.cacheBackwardPreload;
+		tempConfig.previewTiers = config.previewTiers;
 	}
 
 	if (ImGui::CollapsingHeader("Cache")) {
@@ -1274,6 +1607,19 @@ void UI::renderSettingsWindow() {
 		ImGui::TableSetColumnIndex(1);
 		ImGui::SetNextItemWidth(-1.0f);
 		ImGui::InputScalar("##cache_backward_preload", ImGuiDataType_U32, &tempConfig.cacheBackwardPreload, &step, nullptr, "%d", ImGuiInputTextFlags_None);
+
+		ImGui::TableNextRow();
+		ImGui::TableSetColumnIndex(0);
+		ImGui::Text("Larger previews");
+		ImGui::SameLine();
+		ImGui::PushStyleColor(ImGuiCol_Text, Colors::textHint);
+		ImGui::Text("?");
+		ImGui::PopStyleColor();
+		ImGui::SetItemTooltip("Preview sizes to keep in memory in addition to the 75 px list previews. They are created from the same decode, and shown in the contact sheet when its tiles are large enough and in place of images that are still loading. Applies to the next directory opened.");
+		ImGui::TableSetColumnIndex(1);
+		ImGui::CheckboxFlags("256 px", &tempConfig.previewTiers, 1 << PreviewTier_Medium);
+		ImGui::SameLine();
+		ImGui::CheckboxFlags("512 px", &tempConfig.previewTiers, 1 << PreviewTier_Large);
 	
 		ImGui::EndTable();
 
@@ -1285,7 +1631,7 @@ void UI::renderSettingsWindow() {
 	if (ImGui::CollapsingHeader("Key Bindings")) {
 		ImGui::BeginTable("##settings_key_table", 2, ImGuiTableFlags_SizingFixedFit, ImVec2(0.0f, 0.0f));
 
-		const char* keyActions[8] = {
+		const char* keyActions[Config::KeyAction_Count] = {
 			"Save image",
 			"Skip image",
 			"Go to next image",
@@ -1293,9 +1639,12 @@ void UI::renderSettingsWindow() {
 			"Reset image zoom",
 			"Toggle \"Hide skipped images\"",
 			"Toggle \"Lock movement\"",
-			"Return to image groups"
+			"Return to image groups",
+			"Toggle focus peaking",
+			"Toggle clipping",
+			"Show loupe at cursor"
 		};
-		const char* keyBindings[8][4] = {
+		const char* keyBindings[Config::KeyAction_Count][4] = {
 			{ "Space", "Enter", "1", nullptr },
 			{ "Backspace", "X", "2", nullptr },
 			{ "Down arrow", "S", nullptr },
@@ -1303,7 +1652,10 @@ void UI::renderSettingsWindow() {
 			{ "R", "3", nullptr },
 			{ "H", nullptr },
 			{ "L", nullptr },
-			{ "Escape", nullptr }
+			{ "Escape", nullptr },
+			{ "F", nullptr },
+			{ "C", nullptr },
+			{ "Z", nullptr }
 		};
 
 		for (int i = 0; i < Config::KeyAction_Count; i++) {
@@ -1350,6 +1702,86 @@ void UI::renderAboutWindow() {
 	ImGui::End();
 }
 
+void UI::renderSimilarImagesWindow() {
+	ImGui::SetNextWindowPos(ImVec2(
+		ImGui::GetMainViewport()->Size.x / 2.0f - similarImagesWindowSize.x / 2.0f,
+		ImGui::GetMainViewport()->Size.y / 2.0f - similarImagesWindowSize.y / 2.0f
+	), ImGuiCond_Appearing);
+
+	ImGui::SetNextWindowSize(ImVec2(similarImagesWindowSize.x, similarImagesWindowSize.y), ImGuiCond_Appearing);
+	ImGui::PushStyleColor(ImGuiCol_TitleBg, Colors::greenDark);
+	ImGui::PushStyleColor(ImGuiCol_TitleBgActive, Colors::greenDark);
+	ImGui::PushStyleColor(ImGuiCol_Border, Colors::greenDark);
+	ImGui::PushStyleColor(ImGuiCol_SeparatorActive, Colors::greenDark);
+	ImGui::PushStyleColor(ImGuiCol_SeparatorHovered, Colors::greenDark);
+
+	ImGui::Begin("Similar Images", &showSimilarImagesWindow, ImGuiWindowFlags_NoCollapse);
+
+	const Image* source = imageCache->getImage(similarImagesSourceID);
+	ImGui::TextWrapped("%s", source->filename.c_str());
+	if (similarImages.size() == 1) {
+		ImGui::Text("1 similar image");
+	} else {
+		ImGui::Text("%zu similar images", similarImages.size());
+	}
+	ImGui::Separator();
+
+	ImGui::BeginChild("similar_images_scroll_window", ImVec2(-1, -1));
+	ImGuiListClipper clipper;
+	clipper.Begin(static_cast<int>(similarImages.size()), listRowHeight());
+	while (clipper.Step()) {
+		for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+			const Similarity::Match& match = similarImages[row];
+			const Image* image = imageCache->getImage(match.id);
+			ImGui::PushID(match.id);
+
+			ImGui::BeginChild("similar_image_child", ImVec2(-1, listChildHeight), ImGuiChildFlags_Borders);
+			orientedImage(image->previews[PreviewTier_Small].textureId, ImVec2(previewImageSize.x, previewImageSize.y), image->orientation);
+			ImGui::SameLine();
+			ImGui::BeginGroup();
+			ImGui::Text("%s", image->shortFilename.c_str());
+			Group::ImageLocation location;
+			if (Group::findImage(groupIndex, match.id, location)) {
+				ImGui::Text("Group %d", location.group + 1);
+			}
+			ImGui::PushStyleColor(ImGuiCol_Text, Colors::textHint);
+			ImGui::Text("%d bits different", match.distance);
+			ImGui::PopStyleColor();
+			ImGui::EndGroup();
+			ImGui::EndChild();
+			ImGui::Spacing();
+
+			if (ImGui::IsItemHovered(ImGuiHoveredFlags_RectOnly)) {
+				ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
+			}
+			if (ImGui::IsItemClicked() && allowGroupInteraction) {
+				goToImage(match.id);
+			}
+			ImGui::PopID();
+		}
+	}
+	clipper.End();
+	ImGui::EndChild();
+
+	ImGui::End();
+	ImGui::PopStyleColor(5);
+}
+
+void UI::goToImage(int id) {
+	Group::ImageLocation location;
+	if (!Group::findImage(groupIndex, id, location)) return;
+
+	controlPanelState = ControlPanel_ShowFiles;
+	uiState.viewMode = ViewMode_Single;
+	selectedGroup = location.group;
+	onGroupSelected(selectedGroup);
+	selectImage(0, id);
+	for (int imageView = 1; imageView < maxImageViews; imageView++) {
+		selectImage(imageView, -1);
+	}
+	uiState.scrollToSelectedFile = true;
+}
+
 void UI::selectImage(int imageView, int id) {
 	selectedImages[imageView] = id;
 	imageViewer[imageView]->setImage(id);
@@ -1358,25 +1790,70 @@ void UI::selectImage(int imageView, int id) {
 		onImageSelected(id);
 
 		if (uiState.resetZoomOnChange) {
-			imageViewer[imageView]->resetTransform();
-			if (uiState.viewMode == ViewMode_Double && uiState.imageViewMovementLocked) {
-				int otherView = imageView == 1 ? 0 : 1;
-				imageViewer[otherView]->resetTransform();
-			}
+			resetImageViews(imageView);
 		}
 	}
 
-	if (uiState.viewMode == ViewMode_Double) {
-		// The image in the other view needs to be selected as well to avoid it being
-		// evicted from the cache.
-		int otherView = imageView == 1 ? 0 : 1;
-		if (selectedImages[otherView] != -1) {
+	// The images in the other views need to be selected as well to avoid them being
+	// evicted from the cache.
+	for (int otherView = 0; otherView < getImageViewCount(); otherView++) {
+		if (otherView != imageView && selectedImages[otherView] != -1) {
 			onImageSelected(selectedImages[otherView]);
 		}
 	}
 }
 
+void UI::resetImageViews(int imageView) {
+	imageViewer[imageView]->resetTransform();
+	if (uiState.imageViewMovementLocked) {
+		for (int i = 0; i < getImageViewCount(); i++) {
+			imageViewer[i]->resetTransform();
+		}
+	}
+}
+
+int UI::getImageViewCount() const {
+	const glm::ivec2 grid = getImageViewGrid(uiState.viewMode);
+	return grid.x * grid.y;
+}
+
+int UI::getHoveredImageView() {
+	if (uiState.viewMode == ViewMode_ContactSheet) return -1;
+	for (int i = 0; i < getImageViewCount(); i++) {
+		if (mouseOverlappingImage(i)) return i;
+	}
+	return -1;
+}
+
+bool UI::isImageShown(int id) const {
+	if (id == -1) return false;
+	for (int i = 0; i < getImageViewCount(); i++) {
+		if (selectedImages[i] == id) return true;
+	}
+	return false;
+}
+
 namespace {
+/*
+Draws a texture as an item the same way as ImGui::Image, but with texture coordinates mapped for an EXIF
+orientation. Rotated orientations can't be expressed by the two corner UVs of ImGui::Image.
+*/
+void orientedImage(ImTextureID textureId, ImVec2 size, int orientation) {
+	ImVec2 position = ImGui::GetCursorScreenPos();
+	ImGui::Dummy(size);
+
+	const glm::vec2 corners[4] = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+	ImVec2 points[4];
+	ImVec2 uvs[4];
+	for (int i = 0; i < 4; i++) {
+		points[i] = ImVec2(position.x + corners[i].x * size.x, position.y + corners[i].y * size.y);
+		glm::vec2 uv = Orientation::displayToTexture(orientation, corners[i]);
+		uvs[i] = ImVec2(uv.x, uv.y);
+	}
+
+	ImGui::GetWindowDrawList()->AddImageQuad(textureId, points[0], points[1], points[2], points[3], uvs[0], uvs[1], uvs[2], uvs[3]);
+}
+
 std::string bytesToSizeString(unsigned long long bytes) {
 	if (bytes < 1024) {
 		return std::format("{} bytes", bytes);
@@ -1400,105 +1877,170 @@ void UI::setControlPanelState(ControlPanelState newState) {
 
 void UI::reset() {
 	controlPanelState = ControlPanel_NothingLoaded;
-	imageViewer[0]->setImage(-1);
-	imageViewer[1]->setImage(-1);
+	invalidateFileFilter();
+	fileLabels.clear();
+	for (ImageViewer* viewer : imageViewer) {
+		viewer->setImage(-1);
+	}
 	selectedImages.fill(-1);
 	directoryPath.clear();
 	allowGroupInteraction = false;
 	allowExports = false;
+	showSimilarImagesWindow = false;
+	similarImagesSourceID = -1;
+	similarImages.clear();
+	uiState.showLoupe = false;
+	loupe->clear();
+	contactSheet->clear();
 }
 
-void UI::goToNextUnskippedImage(int imageView) {
-	if (imageView > 0 && uiState.viewMode == ViewMode_Single) return;
+void UI::toggleSkipImage(int id) {
+	onSkipImage(id);
+	// Applied when the files list is next built, since this may be called while iterating its rows
+	fileFilter.changedIDs.push_back(id);
+}
 
-	// Find index of selected image within the group
-	int index = -1;
-	for (int i = 0; i < groups[selectedGroup].ids.size(); i++) {
-		if (selectedImages[imageView] == groups[selectedGroup].ids[i]) {
-			index = i;
-			break;
+void UI::invalidateFileFilter() {
+	fileFilter.group = -1;
+	fileFilter.changedIDs.clear();
+}
+
+void UI::updateFileFilter() {
+	const std::vector<int>& groupIDs = groups[selectedGroup].ids;
+	if (fileFilter.group != selectedGroup || fileFilter.hideSkipped != uiState.hideSkippedImages) {
+		fileFilter.group = selectedGroup;
+		fileFilter.hideSkipped = uiState.hideSkippedImages;
+		fileFilter.changedIDs.clear();
+		fileFilter.ids.clear();
+		fileFilter.sharpestID = -1;
+		float maxSharpness = 0.0f;
+		for (int id : groupIDs) {
+			const Image* image = imageCache->getImage(id);
+			if (!fileFilter.hideSkipped || !image->skipped) {
+				fileFilter.ids.push_back(id);
+			}
+			if (image->hasSharpness && image->sharpness > maxSharpness) {
+				maxSharpness = image->sharpness;
+				fileFilter.sharpestID = id;
+			}
 		}
+		return;
 	}
 
-	if (index == -1) return;
+	if (!fileFilter.hideSkipped) {
+		fileFilter.changedIDs.clear();
+		return;
+	}
 
-	// Find the next image that is not skipped
-	for (int i = index + 1; i < groups[selectedGroup].ids.size(); i++) {
-		int newImage = groups[selectedGroup].ids[i];
-		if (newImage == selectedImages[0] || newImage == selectedImages[1]) continue;
-		if (!imageCache->getImage(newImage)->skipped) {
-			selectImage(imageView, newImage);
-			uiState.scrollToSelectedFile = true;
-			break;
+	for (int id : fileFilter.changedIDs) {
+		auto row = std::find(fileFilter.ids.begin(), fileFilter.ids.end(), id);
+		const bool visible = !imageCache->getImage(id)->skipped;
+		if (!visible && row != fileFilter.ids.end()) {
+			fileFilter.ids.erase(row);
+		} else if (visible && row == fileFilter.ids.end()) {
+			// The rows are in group order, so the new row goes after every visible image before it in the group
+			auto groupPosition = std::find(groupIDs.begin(), groupIDs.end(), id);
+			if (groupPosition == groupIDs.end()) continue;
+
+			size_t insertRow = 0;
+			for (auto i = groupIDs.begin(); i != groupPosition; i++) {
+				if (insertRow < fileFilter.ids.size() && fileFilter.ids[insertRow] == *i) {
+					insertRow++;
+				}
+			}
+			fileFilter.ids.insert(fileFilter.ids.begin() + insertRow, id);
 		}
 	}
+	fileFilter.changedIDs.clear();
+}
+
+const UI::FileLabels& UI::getFileLabels(const Image& image) {
+	auto existing = fileLabels.find(image.id);
+	if (existing != fileLabels.end() && existing->second.complete) {
+		return existing->second;
+	}
+
+	FileLabels& labels = fileLabels[image.id];
+	glm::ivec2 displaySize = Orientation::getDisplaySize(image.size, image.orientation);
+	labels.details = std::format("{}, {} x {}", bytesToSizeString(image.filesize), displaySize.x, displaySize.y);
+	if (image.metadata.timestamp.has_value()) {
+		ImageTimestamp t = image.metadata.timestamp.value();
+		labels.date = std::format("{}:{:0>2} {}/{}/{}", t.hour, t.minute, t.month, t.day, t.year);
+	} else {
+		labels.date = "Date unknown";
+	}
+	if (image.hasSharpness) {
+		labels.date += std::format(", sharpness {:.0f}", image.sharpness);
+	}
+	// The size, orientation and date may change once the file info is read, and the sharpness once the preview is
+	labels.complete = image.fileInfoLoaded && image.hasSharpness;
+	return labels;
+}
+
+float UI::listRowHeight() const {
+	// Each row is a child window followed by spacing, both separated by the item spacing
+	return listChildHeight + ImGui::GetStyle().ItemSpacing.y * 2;
+}
+
+void UI::goToNextUnskippedImage(int imageView) {
+	if (imageView >= getImageViewCount()) return;
+
+	int newImage = findUnskippedImage(selectedImages[imageView], true);
+	if (newImage != -1) {
+		selectImage(imageView, newImage);
+		uiState.scrollToSelectedFile = true;
+	}
 }
 
 void UI::goToPreviousUnskippedImage(int imageView) {
-	if (imageView > 0 && uiState.viewMode == ViewMode_Single) return;
+	if (imageView >= getImageViewCount()) return;
 
-	// Find index of selected image within the group
-	int index = -1;
-	for (int i = 0; i < groups[selectedGroup].ids.size(); i++) {
-		if (selectedImages[imageView] == groups[selectedGroup].ids[i]) {
-			index = i;
-			break;
-		}
+	int newImage = findUnskippedImage(selectedImages[imageView], false);
+	if (newImage != -1) {
+		selectImage(imageView, newImage);
+		uiState.scrollToSelectedFile = true;
 	}
+}
 
-	if (index == -1) return;
+int UI::findUnskippedImage(int id, bool forward) const {
+	Group::ImageLocation location;
+	if (!Group::findImage(groupIndex, id, location) || location.group != selectedGroup) return -1;
 
-	// Find the previous image that is not skipped
-	for (int i = index - 1; i >= 0; i--) {
-		int newImage = groups[selectedGroup].ids[i];
-		if (newImage == selectedImages[0] || newImage == selectedImages[1]) continue;
-		if (!imageCache->getImage(newImage)->skipped) {
-			selectImage(imageView, newImage);
-			uiState.scrollToSelectedFile = true;
-			break;
-		}
+	// Unskipped images shown in the image views are passed over
+	int position = location.position;
+	while (true) {
+		position = forward
+			? Group::findNextUnskipped(groupIndex, selectedGroup, position)
+			: Group::findPreviousUnskipped(groupIndex, selectedGroup, position);
+		if (position == -1) return -1;
+
+		int newImage = groups[selectedGroup].ids[position];
+		if (!isImageShown(newImage)) return newImage;
 	}
 }
 
 void UI::skippedImage() {
 	for (int imageView = 0; imageView < selectedImages.size(); imageView++) {
-		if (imageView > 0 && uiState.viewMode == ViewMode_Single) break;
+		if (imageView >= getImageViewCount()) break;
+
+		// Grid panes start out empty
+		if (selectedImages[imageView] == -1) continue;
 
 		// The image for this view isn't skipped, so no update required
 		if (!imageCache->getImage(selectedImages[imageView])->skipped) continue;
 
-		// Find index of selected image within the group
-		int index = -1;
-		for (int i = 0; i < groups[selectedGroup].ids.size(); i++) {
-			if (selectedImages[imageView] == groups[selectedGroup].ids[i]) {
-				index = i;
-				break;
-			}
-		}
+		Group::ImageLocation location;
+		if (!Group::findImage(groupIndex, selectedImages[imageView], location) || location.group != selectedGroup) continue;
 
-		if (index == -1) continue;
-
-		// Search forward for a non-skipped image
-		for (int i = index + 1; i < groups[selectedGroup].ids.size(); i++) {
-			int newImage = groups[selectedGroup].ids[i];
-			if (!imageCache->getImage(newImage)->skipped && newImage != selectedImages[0] && newImage != selectedImages[1]) {
-				selectImage(imageView, newImage);
-				return;
-			}
-		}
-
-		// Search backward for a non-skipped image
-		for (int i = index - 1; i >= 0; i--) {
-			int newImage = groups[selectedGroup].ids[i];
-			if (!imageCache->getImage(groups[selectedGroup].ids[i])->skipped && newImage != selectedImages[0] && newImage != selectedImages[1]) {
-				selectImage(imageView, newImage);
-				return;
-			}
+		// Search forward for a non-skipped image, then backward
+		int newImage = findUnskippedImage(selectedImages[imageView], true);
+		if (newImage == -1) {
+			newImage = findUnskippedImage(selectedImages[imageView], false);
 		}
 
-		// No available images
-		int newImage = -1;
+		// If there are no available images, the view is cleared with -1
 		selectImage(imageView, newImage);
+		if (newImage != -1) return;
 	}
 }
 
@@ -1522,8 +2064,8 @@ void UI::setShowPreviewProgress(bool enabled) {
 }
 
 bool UI::mouseOverlappingImage(int imageView) {
-	// Prevent second image viewer from being interactable in single image mode.
-	if (imageView == 1 && uiState.viewMode == ViewMode_Single) {
+	// Prevent image viewers that aren't shown in the current view mode from being interactable.
+	if (imageView >= getImageViewCount()) {
 		return false;
 	}
 